@@ -0,0 +1,698 @@
+/**@file
+ * @brief Microbenchmarks for <tt>../largemelon.hpp</tt>.
+ * @details Each benchmark runs one of the library's helpers over synthetic
+ *   input of a given size and shape, and the results are written as JSON to
+ *   standard output (or to the file given with <tt>--output</tt>).
+ *
+ * @code{.sh}
+ * bench_largemelon [--sizes N[,N...]] [--shapes SHAPE[,SHAPE...]]
+ *   [--filter SUBSTRING] [--min-time SECONDS] [--output FILE]
+ * @endcode
+ *
+ * The size of a text input is its number of bytes; the size of a tree or
+ * of a sequence of locations or lines is its number of elements. The shapes
+ * are:
+ *
+ * + @c long-lines: text with a newline every 4096 characters;
+ * + @c many-newlines: text with a newline every 8 characters;
+ * + @c crlf: text with a <tt>"\r\n"</tt> sequence every 32 characters;
+ * + @c sequential: disjoint text locations, one after another;
+ * + @c nested: text locations, each enclosing all of the previous ones;
+ * + @c deep: a chain of AST nodes, or ever-increasing block indents;
+ * + @c wide: a single AST node with many child nodes, or block indents
+ *   alternating between zero and one level;
+ * + @c bushy: a tree of AST nodes with four child nodes per node.
+ *
+ * @note Build with <tt>CMAKE_BUILD_TYPE=Release</tt> before trusting any of
+ *   the numbers. With assertions enabled, some helpers (e.g.,
+ *   @ref largemelon::update_block_indents) do a lot of extra checking.*/
+
+#include "../largemelon.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+
+/**@namespace largemelon::bench
+ * @brief Namespace defining benchmark-only, non-production code for
+ *   @c largemelon.*/
+
+namespace largemelon::bench {
+
+
+
+	/**@brief Sink for values computed by benchmarked code, so that the
+	 *   compiler can't discard that code as unused.*/
+	static volatile size_t sink = 0;
+
+	/**@brief Command-line options.*/
+	struct options {
+		/**@brief Input sizes to benchmark.*/
+		std::vector<size_t> sizes = { 1024, 65536 };
+		/**@brief Input shapes to benchmark. All shapes if empty.*/
+		std::vector<std::string> shapes;
+		/**@brief Only benchmarks with names containing this are run.*/
+		std::string filter;
+		/**@brief Minimum number of seconds to spend running each
+		 *   benchmark.*/
+		double min_time = 0.25;
+		/**@brief Path to output file, or empty for standard output.*/
+		std::string output;
+	};
+
+	/**@brief Work done by a single iteration of a benchmark.*/
+	struct workload {
+		/**@brief Code run once per iteration.*/
+		std::function<void()> body;
+		/**@brief Number of input bytes processed per iteration.*/
+		size_t bytes = 0;
+		/**@brief Number of input items (tokens, nodes, lines, ...) processed
+		 *   per iteration.*/
+		size_t items = 0;
+	};
+
+	/**@brief Benchmark for a single helper.*/
+	struct bench_case {
+		/**@brief Name of the benchmark.*/
+		std::string name;
+		/**@brief Input shapes supported by this benchmark.*/
+		std::vector<std::string> shapes;
+		/**@brief Builds the work for an input with the given shape and
+		 *   size.*/
+		std::function<workload(const std::string&, size_t)> setup;
+	};
+
+	/**@brief Measured performance of a single benchmark.*/
+	struct result {
+		std::string name;
+		std::string shape;
+		size_t size;
+		size_t iterations;
+		double ns_per_iter;
+		size_t bytes;
+		size_t items;
+	};
+
+
+
+	/**@brief Synthetic text with a newline sequence every @c period
+	 *   characters.
+	 * @param size Number of characters.
+	 * @param period Number of characters from the start of one newline
+	 *   sequence to the start of the next.
+	 * @param nl Newline sequence.*/
+	inline std::string make_text(const size_t size, const size_t period,
+		const std::string& nl) {
+		static const std::string WORDS = "lorem ipsum\tdolor sit amet, "
+			"consectetur adipiscing elit ";
+		std::string s;
+		s.reserve(size);
+		while (s.size() < size) {
+			if ((s.size() % period) == (period - nl.size())) {
+				s.append(nl);
+			}
+			else {
+				s.push_back(WORDS[s.size() % WORDS.size()]);
+			}
+		}
+		s.resize(size);
+		return s;
+	}
+
+	/**@brief Synthetic text for a named shape.*/
+	inline std::string make_shaped_text(const std::string& shape,
+		const size_t size) {
+		if (shape == "many-newlines") {
+			return make_text(size, 8, "\n");
+		}
+		else if (shape == "crlf") {
+			return make_text(size, 32, "\r\n");
+		}
+		return make_text(size, 4096, "\n");
+	}
+
+	/**@brief Enumerated node type for benchmarked ASTs.*/
+	enum class bench_nt {
+		NODE = 1, ///< Only node type.
+	};
+
+	/**@brief AST node whose child nodes can be reset between iterations.*/
+	class bench_node
+		: public largemelon::ast_typed_base_type<bench_nt, bench_nt::NODE> {
+	public:
+		bench_node(const text_loc& loc)
+			: largemelon::ast_typed_base_type<bench_nt, bench_nt::NODE>(loc) {}
+		/**@brief Adds child nodes through @c add_childs.*/
+		template <typename... ChildTypes>
+		void link(ChildTypes... childs) { add_childs(childs...); }
+		/**@brief Adds child nodes through @c add_child_range.*/
+		template <typename IteratorType>
+		void link_range(IteratorType first, IteratorType last) {
+			add_child_range(first, last);
+		}
+		/**@brief Removes all child nodes, which become root nodes again, so
+		 *   that they can be added anew.*/
+		void reset() {
+			bench_node none(EMPTY_TEXT_LOC);
+			splice_childs(0, childs_.size(), none);
+		}
+	};
+
+	/**@brief Stops the benchmarks if a node doesn't have the expected number
+	 *   of child nodes, rather than go on timing the wrong work.*/
+	inline void check_childs(const bench_node& n, const size_t nchilds) {
+		if (n.childs().size() != nchilds) {
+			std::cerr << "expected " << nchilds << " child nodes, got "
+				<< n.childs().size() << std::endl;
+			std::abort();
+		}
+	}
+
+	/**@brief Allocates @c n AST nodes, each one on its own line.*/
+	inline std::vector< std::unique_ptr<bench_node> > make_nodes(
+		const size_t n) {
+		std::vector< std::unique_ptr<bench_node> > nodes;
+		nodes.reserve(n);
+		for (size_t i=0; i<n; i++) {
+			nodes.emplace_back(new bench_node({i + 1, 1, i + 1, 8}));
+		}
+		return nodes;
+	}
+
+
+
+	/**@brief All benchmarks.*/
+	inline std::vector<bench_case> make_cases() {
+		const std::vector<std::string> text_shapes = {
+			"long-lines", "many-newlines", "crlf" };
+		std::vector<bench_case> cases;
+
+		cases.push_back({ "mtext_loc", text_shapes,
+			[](const std::string& shape, const size_t size) {
+				auto text = std::make_shared<std::string>(
+					make_shaped_text(shape, size));
+				return workload{ [text]() {
+					text_loc loc = mtext_loc(FIRST_TEXT_LOC, *text);
+					sink = sink + loc.last_lno;
+				}, size, 1 };
+			} });
+
+		cases.push_back({ "mtext_loc_per_token", text_shapes,
+			[](const std::string& shape, const size_t size) {
+				auto text = std::make_shared<std::string>(
+					make_shaped_text(shape, size));
+				return workload{ [text]() {
+					text_loc loc = FIRST_TEXT_LOC;
+					for (size_t i=0; i<text->size(); i+=16) {
+						loc = mtext_loc(loc, text->substr(i, 16));
+					}
+					sink = sink + loc.last_lno;
+				}, size, (size + 15) / 16 };
+			} });
+
+		cases.push_back({ "mtext_loc_padded_per_token", text_shapes,
+			[](const std::string& shape, const size_t size) {
+				auto buf = std::make_shared<input_buffer>();
+				std::string text = make_shaped_text(shape, size);
+				buf->assign(text.data(), text.size());
+				return workload{ [buf]() {
+					text_loc loc = FIRST_TEXT_LOC;
+					const char *p = buf->data();
+					const char *pe = p + buf->size();
+					for (; p<pe; p+=16) {
+						loc = mtext_loc_padded(loc, p, std::min(p + 16, pe));
+					}
+					sink = sink + loc.last_lno;
+				}, size, (size + 15) / 16 };
+			} });
+
+		cases.push_back({ "mtext_loc_lf_padded_per_token", text_shapes,
+			[](const std::string& shape, const size_t size) {
+				auto buf = std::make_shared<input_buffer>();
+				std::string text = make_shaped_text(shape, size);
+				buf->assign(text.data(), text.size());
+				newline_map map;
+				buf->normalize_newlines(map);
+				return workload{ [buf]() {
+					text_loc loc = FIRST_TEXT_LOC;
+					const char *p = buf->data();
+					const char *pe = p + buf->size();
+					for (; p<pe; p+=16) {
+						loc = mtext_loc_lf_padded(loc, p, std::min(p + 16, pe));
+					}
+					sink = sink + loc.last_lno;
+				}, size, (size + 15) / 16 };
+			} });
+
+		cases.push_back({ "normalize_newlines", text_shapes,
+			[](const std::string& shape, const size_t size) {
+				auto text = std::make_shared<std::string>(
+					make_shaped_text(shape, size));
+				auto out = std::make_shared<std::string>(size, '\0');
+				return workload{ [text, out]() {
+					newline_map map;
+					sink = sink + normalize_newlines(text->data(), text->size(),
+						&(*out)[0], map);
+				}, size, 1 };
+			} });
+
+		cases.push_back({ "escstr", text_shapes,
+			[](const std::string& shape, const size_t size) {
+				auto text = std::make_shared<std::string>(
+					make_shaped_text(shape, size));
+				return workload{ [text]() {
+					sink = sink + escstr(*text).size();
+				}, size, 1 };
+			} });
+
+		cases.push_back({ "toktext", text_shapes,
+			[](const std::string& shape, const size_t size) {
+				auto text = std::make_shared<std::string>(
+					make_shaped_text(shape, size));
+				return workload{ [text]() {
+					const char *p = text->c_str();
+					const char *pe = p + text->size();
+					for (; p + 16 <= pe; p+=16) {
+						sink = sink + toktext(p, p + 16).size();
+					}
+				}, size, size / 16 };
+			} });
+
+		cases.push_back({ "span_loc", { "sequential", "nested" },
+			[](const std::string& shape, const size_t size) {
+				auto locs = std::make_shared< std::vector<text_loc> >();
+				locs->reserve(size);
+				for (size_t i=0; i<size; i++) {
+					if (shape == "nested") {
+						locs->push_back({ size - i, size - i, size + i,
+							size + i });
+					}
+					else {
+						locs->push_back({ i + 1, 1, i + 1, 80 });
+					}
+				}
+				return workload{ [locs]() {
+					text_loc loc = EMPTY_TEXT_LOC;
+					for (auto& l: *locs) {
+						loc = span_loc(loc, l);
+					}
+					sink = sink + loc.last_lno;
+				}, 0, size };
+			} });
+
+		cases.push_back({ "ast_span_loc", { "sequential" },
+			[](const std::string& shape, const size_t size) {
+				LARGEMELON_UNUSED_PARAM(shape);
+				auto nodes = std::make_shared<
+					std::vector< std::unique_ptr<bench_node> > >(
+					make_nodes(size < 4 ? 4 : size));
+				return workload{ [nodes]() {
+					auto& ns = *nodes;
+					for (size_t i=0; i+4<=ns.size(); i+=4) {
+						text_loc loc = ast_span_loc<bench_nt>(ns[i].get(),
+							ns[i+1].get(), ns[i+2].get(), ns[i+3].get());
+						sink = sink + loc.last_lno;
+					}
+				}, 0, size };
+			} });
+
+		cases.push_back({ "update_block_indents", { "deep", "wide" },
+			[](const std::string& shape, const size_t size) {
+				auto widths = std::make_shared< std::vector<size_t> >();
+				widths->reserve(size);
+				const size_t max_depth = 64;
+				for (size_t i=0; i<size; i++) {
+					if (shape == "deep") {
+						// up the staircase, then all the way back down
+						widths->push_back(4 * (i % (max_depth + 1)));
+					}
+					else {
+						widths->push_back(4 * (i % 2));
+					}
+				}
+				return workload{ [widths]() {
+					std::vector<size_t> prev_widths;
+					int indent_change = 0;
+					for (auto& w: *widths) {
+						update_block_indents(indent_change, prev_widths, w);
+						sink = sink + indent_change;
+					}
+				}, 0, size };
+			} });
+
+		cases.push_back({ "block_indent_tracker", { "deep", "wide" },
+			[](const std::string& shape, const size_t size) {
+				auto widths = std::make_shared< std::vector<size_t> >();
+				widths->reserve(size);
+				const size_t max_depth = 64;
+				for (size_t i=0; i<size; i++) {
+					if (shape == "deep") {
+						widths->push_back(4 * (i % (max_depth + 1)));
+					}
+					else {
+						widths->push_back(4 * (i % 2));
+					}
+				}
+				return workload{ [widths]() {
+					block_indent_tracker tracker;
+					int indent_change = 0;
+					for (auto& w: *widths) {
+						tracker.update(indent_change, w);
+						sink = sink + indent_change;
+					}
+				}, 0, size };
+			} });
+
+		cases.push_back({ "measure_indent", { "deep", "wide" },
+			[](const std::string& shape, const size_t size) {
+				auto text = std::make_shared<std::string>();
+				auto starts = std::make_shared< std::vector<size_t> >();
+				starts->reserve(size);
+				const size_t max_depth = 64;
+				for (size_t i=0; i<size; i++) {
+					size_t depth = (shape == "deep")
+						? (i % (max_depth + 1)) : (i % 2);
+					starts->push_back(text->size());
+					text->append(depth / 2, '\t').append(4 * (depth % 2), ' ')
+						.append("x = 1;\n");
+				}
+				return workload{ [text, starts]() {
+					block_indent_tracker tracker;
+					const char *te = text->data() + text->size();
+					int indent_change = 0;
+					size_t indent_size;
+					for (auto& i: *starts) {
+						tracker.update_line< indent_tab_stops<8> >(
+							indent_change, indent_size, text->data() + i, te);
+						sink = sink + indent_change;
+					}
+				}, text->size(), size };
+			} });
+
+		cases.push_back({ "add_childs", { "deep", "wide", "bushy" },
+			[](const std::string& shape, const size_t size) {
+				auto nodes = std::make_shared<
+					std::vector< std::unique_ptr<bench_node> > >(
+					make_nodes(size + 1));
+				std::function<void()> body;
+				if (shape == "deep") {
+					body = [nodes]() {
+						auto& ns = *nodes;
+						for (size_t i=0; i+1<ns.size(); i++) {
+							ns[i]->reset();
+							ns[i]->link(ns[i+1].get());
+						}
+						check_childs(*ns[0], 1);
+						sink = sink + ns[0]->childs().size();
+					};
+				}
+				else if (shape == "wide") {
+					body = [nodes]() {
+						auto& ns = *nodes;
+						ns[0]->reset();
+						for (size_t i=1; i<ns.size(); i++) {
+							ns[0]->link(ns[i].get());
+						}
+						check_childs(*ns[0], ns.size() - 1);
+						sink = sink + ns[0]->childs().size();
+					};
+				}
+				else {
+					body = [nodes]() {
+						auto& ns = *nodes;
+						for (size_t i=0; 4*i+4<ns.size(); i++) {
+							ns[i]->reset();
+							ns[i]->link(ns[4*i+1].get(), ns[4*i+2].get(),
+								ns[4*i+3].get(), ns[4*i+4].get());
+						}
+						check_childs(*ns[0], (ns.size() >= 5) ? 4 : 0);
+						sink = sink + ns[0]->childs().size();
+					};
+				}
+				return workload{ body, 0, size };
+			} });
+
+		cases.push_back({ "add_child_range", { "wide" },
+			[](const std::string&, const size_t size) {
+				auto nodes = std::make_shared<
+					std::vector< std::unique_ptr<bench_node> > >(
+					make_nodes(size + 1));
+				auto childs = std::make_shared< std::vector<bench_node*> >();
+				for (size_t i=1; i<nodes->size(); i++) {
+					childs->push_back((*nodes)[i].get());
+				}
+				return workload{ [nodes, childs]() {
+					auto& root = *(*nodes)[0];
+					root.reset();
+					root.link_range(childs->begin(), childs->end());
+					check_childs(root, childs->size());
+					sink = sink + root.childs().size();
+				}, 0, size };
+			} });
+
+		cases.push_back({ "ast_new_delete", { "bushy" },
+			[](const std::string&, const size_t size) {
+				return workload{ [size]() {
+					std::vector<bench_node*> ns;
+					ns.reserve(size);
+					for (size_t i=0; i<size; i++) {
+						ns.push_back(new bench_node({i + 1, 1, i + 1, 8}));
+						if (i > 0) {
+							ns[(i - 1) / 4]->link(ns[i]);
+						}
+					}
+					sink = sink + ns[0]->childs().size();
+					for (auto& n: ns) {
+						delete n;
+					}
+				}, 0, size };
+			} });
+
+		cases.push_back({ "ast_node_arena", { "bushy" },
+			[](const std::string&, const size_t size) {
+				auto nodes = std::make_shared<
+					largemelon::ast_node_arena<bench_nt> >();
+				return workload{ [nodes, size]() {
+					std::vector<bench_node*> ns;
+					ns.reserve(size);
+					for (size_t i=0; i<size; i++) {
+						ns.push_back(nodes->make<bench_node>(
+							text_loc{i + 1, 1, i + 1, 8}));
+						if (i > 0) {
+							ns[(i - 1) / 4]->link(ns[i]);
+						}
+					}
+					sink = sink + ns[0]->childs().size();
+					nodes->release();
+				}, 0, size };
+			} });
+
+		cases.push_back({ "ast_walk", { "bushy" },
+			[](const std::string&, const size_t size) {
+				auto nodes = std::make_shared<
+					std::vector< std::unique_ptr<bench_node> > >(
+					make_nodes(size));
+				for (size_t i=1; i<size; i++) {
+					(*nodes)[(i - 1) / 4]->link((*nodes)[i].get());
+				}
+				return workload{ [nodes]() {
+					std::vector<const largemelon::ast_base_type<bench_nt>*>
+						stack = { (*nodes)[0].get() };
+					size_t total = 0;
+					while (! stack.empty()) {
+						auto n = stack.back();
+						stack.pop_back();
+						total += n->loc().last_lno;
+						for (auto child: n->childs()) {
+							stack.push_back(child);
+						}
+					}
+					sink = sink + total;
+				}, 0, size };
+			} });
+
+		cases.push_back({ "flat_ast_walk", { "bushy" },
+			[](const std::string&, const size_t size) {
+				using flat_ast_type = largemelon::flat_ast<bench_nt>;
+				auto ast = std::make_shared<flat_ast_type>();
+				ast->reserve(size);
+				for (size_t i=0; i<size; i++) {
+					ast->add_node(bench_nt::NODE, {i + 1, 1, i + 1, 8});
+					if (i > 0) {
+						auto id = static_cast<flat_ast_type::node_id>(i);
+						ast->add_child((id - 1) / 4, id);
+					}
+				}
+				return workload{ [ast]() {
+					std::vector<flat_ast_type::node_id> stack = { 0 };
+					size_t total = 0;
+					while (! stack.empty()) {
+						auto n = stack.back();
+						stack.pop_back();
+						total += ast->loc(n).last_lno;
+						auto c = ast->first_child(n);
+						for (; c!=flat_ast_type::NO_NODE;
+							c=ast->next_sibling(c)) {
+							stack.push_back(c);
+						}
+					}
+					sink = sink + total;
+				}, 0, size };
+			} });
+
+		return cases;
+	}
+
+
+
+	/**@brief Runs a single benchmark until at least @c min_time seconds have
+	 *   passed, doubling the number of iterations per batch.
+	 * @return Result from the fastest batch.*/
+	inline result run(const std::string& name, const std::string& shape,
+		const size_t size, const workload& w, const double min_time) {
+		using clock = std::chrono::steady_clock;
+		w.body(); // warm up
+		result r = { name, shape, size, 0, 0.0, w.bytes, w.items };
+		double best = -1.0;
+		double total = 0.0;
+		size_t batch = 1;
+		do {
+			auto t0 = clock::now();
+			for (size_t i=0; i<batch; i++) {
+				w.body();
+			}
+			double elapsed = std::chrono::duration<double>(
+				clock::now() - t0).count();
+			double per_iter = elapsed / batch;
+			if (best < 0.0 || per_iter < best) {
+				best = per_iter;
+			}
+			total += elapsed;
+			r.iterations += batch;
+			batch *= 2;
+		} while (total < min_time);
+		r.ns_per_iter = best * 1e9;
+		return r;
+	}
+
+	/**@brief Serializes benchmark results as a JSON document.*/
+	inline void write_json(std::ostream& os,
+		const std::vector<result>& results) {
+		os << "{\n  \"context\": {\n"
+#if defined(NDEBUG)
+			<< "    \"assertions\": false\n"
+#else
+			<< "    \"assertions\": true\n"
+#endif
+			<< "  },\n  \"benchmarks\": [";
+		for (size_t i=0; i<results.size(); i++) {
+			const result& r = results[i];
+			double secs = r.ns_per_iter / 1e9;
+			os << (i == 0 ? "\n" : ",\n")
+				<< "    {\"name\": \"" << r.name << "\""
+				<< ", \"shape\": \"" << r.shape << "\""
+				<< ", \"size\": " << r.size
+				<< ", \"iterations\": " << r.iterations
+				<< ", \"ns_per_iter\": " << r.ns_per_iter;
+			if (r.bytes > 0) {
+				os << ", \"bytes_per_second\": " << (r.bytes / secs);
+			}
+			if (r.items > 0) {
+				os << ", \"items_per_second\": " << (r.items / secs);
+			}
+			os << "}";
+		}
+		os << "\n  ]\n}\n";
+	}
+
+	/**@brief Splits a comma-separated list.*/
+	inline std::vector<std::string> split_list(const std::string& s) {
+		std::vector<std::string> items;
+		std::stringstream ss(s);
+		std::string item;
+		while (std::getline(ss, item, ',')) {
+			if (! item.empty())
+				items.push_back(item);
+		}
+		return items;
+	}
+
+	/**@brief Parses command-line arguments.
+	 * @return @c 0 on success, nonzero otherwise.*/
+	inline int parse_args(options& opts, const int argc, char **argv) {
+		for (int i=1; i<argc; i++) {
+			std::string arg = argv[i];
+			if (arg == "--help" || arg == "-h" || (i + 1) >= argc) {
+				return 1;
+			}
+			std::string val = argv[++i];
+			if (arg == "--sizes") {
+				opts.sizes.clear();
+				for (auto& s: split_list(val))
+					opts.sizes.push_back(std::strtoull(s.c_str(), nullptr, 0));
+			}
+			else if (arg == "--shapes") {
+				opts.shapes = split_list(val);
+			}
+			else if (arg == "--filter") {
+				opts.filter = val;
+			}
+			else if (arg == "--min-time") {
+				opts.min_time = std::strtod(val.c_str(), nullptr);
+			}
+			else if (arg == "--output") {
+				opts.output = val;
+			}
+			else {
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+
+
+} // namespace largemelon::bench
+
+
+
+int main(int argc, char **argv) {
+	using namespace largemelon::bench;
+	options opts;
+	if (parse_args(opts, argc, argv) != 0) {
+		std::cerr << "usage: " << argv[0] << " [--sizes N[,N...]]"
+			<< " [--shapes SHAPE[,SHAPE...]] [--filter SUBSTRING]"
+			<< " [--min-time SECONDS] [--output FILE]" << std::endl;
+		return 2;
+	}
+	std::vector<result> results;
+	for (auto& c: make_cases()) {
+		if (c.name.find(opts.filter) == std::string::npos)
+			continue;
+		for (auto& shape: c.shapes) {
+			if (! opts.shapes.empty() && std::find(opts.shapes.begin(),
+				opts.shapes.end(), shape) == opts.shapes.end())
+				continue;
+			for (auto size: opts.sizes) {
+				std::cerr << c.name << "/" << shape << "/" << size << std::endl;
+				results.push_back(run(c.name, shape, size, c.setup(shape, size),
+					opts.min_time));
+			}
+		}
+	}
+	if (opts.output.empty()) {
+		write_json(std::cout, results);
+	}
+	else {
+		std::ofstream ofs(opts.output);
+		write_json(ofs, results);
+	}
+	return 0;
+}
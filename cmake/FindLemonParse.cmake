@@ -165,10 +165,10 @@ if(${LemonParse_FORCE_LOCAL})
 	set(LemonParse_FOUND NO)
 else()
 	find_program(LemonParse_EXECUTABLE lemon DOC "Lemon parser generator")
-	if(DEFINED ${LemonParse_EXECUTABLE-NOTFOUND})
-		set(LemonParse_FOUND NO)
-	else()
+	if(LemonParse_EXECUTABLE)
 		set(LemonParse_FOUND YES)
+	else()
+		set(LemonParse_FOUND NO)
 	endif()
 endif()
 if(NOT ${LemonParse_FOUND})
@@ -328,10 +328,12 @@ function(LemonParse_generate_sources)
 	endif()
 	set(input_file_  "${ARGV1}")
 	set(output_file_ "${ARGV2}")
-	cmake_path(REPLACE_EXTENSION input_file_ LAST_ONLY ".c"
-		OUTPUT_VARIABLE output_c_file_)
-	cmake_path(REPLACE_EXTENSION input_file_ LAST_ONLY ".h"
-		OUTPUT_VARIABLE pre_output_h_file_)
+	# Lemon writes its outputs to the output directory, named after the input
+	# file, so they must be renamed from there.
+	cmake_path(GET output_file_ PARENT_PATH output_dir_)
+	cmake_path(GET input_file_ STEM LAST_ONLY input_stem_)
+	set(output_c_file_ "${output_dir_}/${input_stem_}.c")
+	set(pre_output_h_file_ "${output_dir_}/${input_stem_}.h")
 	if(DEFINED arg_OUTPUT_HEADER)
 		set(output_h_file_ ${arg_OUTPUT_HEADER})
 	else()
@@ -361,7 +363,6 @@ function(LemonParse_generate_sources)
 	if(arg_TEMPLATE)
 		set(template_cmdarg_ "-T${arg_TEMPLATE}")
 	endif()
-	cmake_path(GET output_file_ PARENT_PATH output_dir_)
 	message(DEBUG "Will generate C/C++ parser sources:")
 	message(DEBUG "  executable path: `${LemonParse_EXECUTABLE}`")
 	message(DEBUG "  variable:        ${ARGV0}")
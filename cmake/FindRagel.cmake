@@ -44,10 +44,14 @@ Generates a Ragel finite-state machine or scanner.
 .. code-block:: cmake
    
    ragel_scanner_generate(
+     INPUT_FILE <input_file>
      OUTPUT_FILE <output_file>
    )
 
 This function wraps at least most of the arguments to the ``ragel`` executable.
+The scanner is generated at build-time from the Ragel specification at
+``<input_file>``, by way of :command:`add_custom_command`; add
+``<output_file>`` to a target's sources to build it.
 
 General options
 """""""""""""""
@@ -162,15 +166,71 @@ function(ragel_scanner_generate)
 		FAST_FLAT_TABLE_FSM GOTO_FSM FAST_GOTO_FSM VERY_FAST_GOTO_FSM
 		SPLIT_GOTO_FSM
 	)
-	set(_oneval_keywords OUTPUT_FILE ERROR_FORMAT MINIMIZE)
+	set(_oneval_keywords INPUT_FILE OUTPUT_FILE ERROR_FORMAT MINIMIZE)
 	set(_multival_keywords IMPORT_DIRS)
 	cmake_parse_arguments(PARSE_ARGV 0 Ragel_
-	  ${_options} ${_oneval_keywords} ${_multival_keywords})
+	  "${_options}" "${_oneval_keywords}" "${_multival_keywords}")
+	if(NOT Ragel_EXECUTABLE)
+		message(FATAL_ERROR "Ragel executable not found")
+	endif()
+	if(NOT Ragel__INPUT_FILE OR NOT Ragel__OUTPUT_FILE)
+		message(FATAL_ERROR "INPUT_FILE and OUTPUT_FILE are required")
+	endif()
 	
+	set(_args )
+	if(Ragel__KEEP_DUPLICATES)
+		list(APPEND _args "-d")
+	endif()
+	if(Ragel__NO_LINE_DIRS)
+		list(APPEND _args "-L")
+	endif()
+	if(Ragel__ERROR_FORMAT)
+		list(APPEND _args "--error-format=${Ragel__ERROR_FORMAT}")
+	endif()
+	foreach(_dir ${Ragel__IMPORT_DIRS})
+		list(APPEND _args "-I" "${_dir}")
+	endforeach()
+	
+	if(Ragel__NO_MINIMIZE OR (Ragel__MINIMIZE STREQUAL "NONE"))
+		list(APPEND _args "-n")
+	elseif(Ragel__MINIMIZE STREQUAL "END")
+		list(APPEND _args "-m")
+	elseif(Ragel__MINIMIZE STREQUAL "EVERY")
+		list(APPEND _args "-e")
+	elseif(Ragel__MINIMIZE STREQUAL "MOST")
+		list(APPEND _args "-l")
+	endif()
+	
+	if(Ragel__TABLE_FSM)
+		list(APPEND _args "-T0")
+	elseif(Ragel__FAST_TABLE_FSM)
+		list(APPEND _args "-T1")
+	elseif(Ragel__FLAT_TABLE_FSM)
+		list(APPEND _args "-F0")
+	elseif(Ragel__FAST_FLAT_TABLE_FSM)
+		list(APPEND _args "-F1")
+	elseif(Ragel__GOTO_FSM)
+		list(APPEND _args "-G0")
+	elseif(Ragel__FAST_GOTO_FSM)
+		list(APPEND _args "-G1")
+	elseif(Ragel__VERY_FAST_GOTO_FSM)
+		list(APPEND _args "-G2")
+	elseif(Ragel__SPLIT_GOTO_FSM)
+		list(APPEND _args "-P")
+	endif()
+	
+	add_custom_command(
+		OUTPUT ${Ragel__OUTPUT_FILE}
+		COMMAND ${Ragel_EXECUTABLE} ${_args} -o ${Ragel__OUTPUT_FILE}
+			${Ragel__INPUT_FILE}
+		DEPENDS ${Ragel__INPUT_FILE}
+		COMMENT "Generating Ragel scanner: `${Ragel__INPUT_FILE}` \
+-> `${Ragel__OUTPUT_FILE}`"
+	)
 endfunction()
 
 find_program(Ragel_EXECUTABLE ragel)
-if(RAGEL_EXECUTABLE)
+if(Ragel_EXECUTABLE)
 	set(Ragel_FOUND YES)
 else()
 	ragel_scanner_find_and_build()
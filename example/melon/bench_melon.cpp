@@ -0,0 +1,193 @@
+/**@file
+ * @brief End-to-end throughput benchmark for the melon reference language:
+ *   Ragel scanner, Lemon parser, and AST construction together.
+ * @details Corpora are generated in memory, starting at 1 KiB and growing
+ *   sixteen-fold up to the maximum size, and each one is parsed at least
+ *   once. Results are written as JSON, in bytes and tokens per second.
+ *
+ * @code{.sh}
+ * bench_melon [--min-size BYTES] [--max-size BYTES] [--min-time SECONDS]
+ *   [--threads N] [--stream] [--output FILE]
+ * @endcode
+ *
+ * Sizes accept a @c K, @c M, or @c G suffix. The default maximum is @c 64M;
+ * use <tt>--max-size 1G</tt> for the full range, with enough memory for
+ * the AST of a 1 GiB source file. With <tt>--threads</tt> other than @c 1,
+ * each corpus is parsed with @c melon::parse_parallel on that many threads
+ * (@c 0 for one per core). With <tt>--stream</tt>, declarations are handed
+ * to a @c largemelon::ast_stream_sink and freed as soon as they're parsed,
+ * instead of the whole AST being built.*/
+
+#include "melon.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+
+namespace melon::bench {
+
+
+
+	/**@brief Measured throughput for a single corpus size.*/
+	struct result {
+		size_t size;
+		size_t tokens;
+		size_t iterations;
+		double seconds;
+	};
+
+	/**@brief Generates a melon source text of at least @c size bytes.
+	 * @details Declarations mix every kind of token, comments, and nested
+	 *   expressions, with a fixed-seed generator so that corpora are the same
+	 *   from run to run.*/
+	inline std::string make_corpus(const size_t size) {
+		static const char *NAMES[] = { "alpha", "beta", "gamma_2", "delta",
+			"epsilon", "zeta_value", "eta", "theta" };
+		static const char *OPS[] = { " + ", " - ", " * ", " / ", " || " };
+		std::string s;
+		unsigned long seed = 12345;
+		auto next = [&seed](const unsigned long n) {
+			seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+			return (seed >> 33) % n;
+		};
+		s.reserve(size + 128);
+		for (size_t i=0; s.size()<size; i++) {
+			if (next(8) == 0) {
+				s.append("# declaration ").append(std::to_string(i))
+					.append("\n");
+			}
+			s.append(NAMES[next(8)]).append("_").append(std::to_string(i))
+				.append(" = ");
+			size_t nterms = 1 + next(5);
+			for (size_t t=0; t<nterms; t++) {
+				if (t > 0) {
+					s.append(OPS[next(5)]);
+				}
+				switch (next(6)) {
+					case 0: s.append(std::to_string(next(100000))); break;
+					case 1: s.append(next(2) ? "true" : "false"); break;
+					case 2: s.append("\"some text\\n\""); break;
+					case 3: s.append(NAMES[next(8)]); break;
+					case 4:
+						s.append("(").append(std::to_string(next(10)))
+							.append(" * ").append(NAMES[next(8)]).append(")");
+						break;
+					default: s.append(std::to_string(next(10))); break;
+				}
+			}
+			s.append(";\n");
+		}
+		return s;
+	}
+
+	/**@brief Parses a size with an optional @c K, @c M, or @c G suffix.*/
+	inline size_t parse_size(const std::string& s) {
+		char *end = nullptr;
+		size_t n = std::strtoull(s.c_str(), &end, 0);
+		switch (*end) {
+			case 'K': case 'k': n <<= 10; break;
+			case 'M': case 'm': n <<= 20; break;
+			case 'G': case 'g': n <<= 30; break;
+			default: break;
+		}
+		return n;
+	}
+
+
+
+} // namespace melon::bench
+
+
+
+int main(int argc, char **argv) {
+	using namespace melon::bench;
+	using clock = std::chrono::steady_clock;
+	size_t min_size = 1 << 10;
+	size_t max_size = 64 << 20;
+	double min_time = 0.5;
+	size_t nthreads = 1;
+	bool stream = false;
+	std::string output;
+	for (int i=1; i<argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--stream") {
+			stream = true;
+			continue;
+		}
+		if (i + 1 == argc)
+			arg.clear();
+		if (arg == "--min-size")
+			min_size = parse_size(argv[++i]);
+		else if (arg == "--max-size")
+			max_size = parse_size(argv[++i]);
+		else if (arg == "--min-time")
+			min_time = std::strtod(argv[++i], nullptr);
+		else if (arg == "--threads")
+			nthreads = std::strtoull(argv[++i], nullptr, 0);
+		else if (arg == "--output")
+			output = argv[++i];
+		else {
+			std::cerr << "usage: " << argv[0] << " [--min-size BYTES]"
+				<< " [--max-size BYTES] [--min-time SECONDS] [--threads N]"
+				<< " [--stream] [--output FILE]" << std::endl;
+			return 2;
+		}
+	}
+
+	std::vector<result> results;
+	for (size_t size=min_size; size<=max_size; size*=16) {
+		std::string corpus = make_corpus(size);
+		result r = { corpus.size(), 0, 0, 0.0 };
+		std::cerr << "melon_parse/" << r.size << std::endl;
+		do {
+			size_t ndecls = 0;
+			largemelon::ast_stream_sink<melon::nt> sink(
+				[&ndecls](melon::ast&) { ndecls++; });
+			melon::context ctx;
+			if (stream) {
+				ctx.sink = &sink;
+			}
+			auto t0 = clock::now();
+			int rc = (nthreads == 1)
+				? melon::parse(ctx, corpus.data(), corpus.size(),
+					"corpus.melon")
+				: melon::parse_parallel(ctx, corpus.data(), corpus.size(),
+					"corpus.melon", nthreads);
+			r.seconds += std::chrono::duration<double>(
+				clock::now() - t0).count();
+			if (rc != 0) {
+				for (auto& d: ctx.diagnostics) {
+					std::cerr << d.loc << ": " << d.message << std::endl;
+				}
+				return 1;
+			}
+			r.tokens = ctx.ntokens;
+			r.iterations++;
+		} while (r.seconds < min_time);
+		results.push_back(r);
+	}
+
+	std::ofstream ofs;
+	if (! output.empty())
+		ofs.open(output);
+	std::ostream& os = output.empty() ? std::cout : ofs;
+	os << "{\n  \"benchmarks\": [";
+	for (size_t i=0; i<results.size(); i++) {
+		const result& r = results[i];
+		double secs = r.seconds / r.iterations;
+		os << (i == 0 ? "\n" : ",\n")
+			<< "    {\"name\": \"melon_parse\""
+			<< ", \"size\": " << r.size
+			<< ", \"tokens\": " << r.tokens
+			<< ", \"iterations\": " << r.iterations
+			<< ", \"seconds_per_iter\": " << secs
+			<< ", \"mb_per_second\": " << (r.size / secs / 1e6)
+			<< ", \"tokens_per_second\": " << (r.tokens / secs) << "}";
+	}
+	os << "\n  ]\n}\n";
+	return 0;
+}
@@ -0,0 +1,245 @@
+/**@file
+ * @brief AST, parsing context, and entry points for "melon", a small
+ *   reference language built on <tt>largemelon.hpp</tt>.
+ * @details A melon source file is a list of declarations, each binding a
+ *   name to an expression:
+ * @code{.unparsed}
+ * # comments run to the end of the line
+ * greeting = "hello, world";
+ * answer = (4 + 2) * 7;
+ * verbose = false || answer;
+ * @endcode
+ * The scanner is generated by Ragel from <tt>melon_scanner.rl</tt>, and the
+ * parser is generated by Lemon from <tt>melon_parser.y</tt>. Together, they
+ * give every performance feature in @c largemelon a realistic pipeline to be
+ * measured against (see <tt>bench_melon.cpp</tt>).*/
+
+#ifndef LARGEMELON_EXAMPLE_MELON_HPP
+#define LARGEMELON_EXAMPLE_MELON_HPP
+
+#include "../../largemelon.hpp"
+#include <cstdlib>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**@namespace melon
+ * @brief Reference language built on @c largemelon.*/
+
+namespace melon {
+
+
+
+	/**@brief Enumerated node type.*/
+	enum class nt {
+		PROGRAM = 1,    ///< List of declarations.
+		DECL,           ///< Declaration.
+		BINOP,          ///< Binary operation.
+		INT_LITERAL,    ///< Integer literal.
+		BOOL_LITERAL,   ///< Boolean literal.
+		STRING_LITERAL, ///< String literal.
+		IDENT_REF,      ///< Reference to a declared name.
+	};
+
+	/**@brief Base AST node type.*/
+	using ast = largemelon::ast_base_type<nt>;
+
+	/**@brief Extends @c ast to associate it with @c nt.*/
+	template <nt N>
+	using ast_typed = largemelon::ast_typed_base_type<nt, N>;
+
+
+
+	/**@brief AST node for an integer literal.*/
+	class ast_int_literal : public ast_typed<nt::INT_LITERAL> {
+		long long value_;
+	public:
+		ast_int_literal(const largemelon::text_loc& loc, const long long value)
+			: ast_typed<nt::INT_LITERAL>(loc), value_(value) {}
+		long long value() const { return value_; }
+	};
+
+	/**@brief AST node for a Boolean literal.*/
+	class ast_bool_literal : public ast_typed<nt::BOOL_LITERAL> {
+		bool value_;
+	public:
+		ast_bool_literal(const largemelon::text_loc& loc, const bool value)
+			: ast_typed<nt::BOOL_LITERAL>(loc), value_(value) {}
+		bool value() const { return value_; }
+	};
+
+	/**@brief AST node for a string literal.*/
+	class ast_string_literal : public ast_typed<nt::STRING_LITERAL> {
+		std::string value_;
+	public:
+		/**@brief Constructor.
+		 * @param loc Location of the literal, including its quotes.
+		 * @param value Text of the literal, excluding its quotes.*/
+		ast_string_literal(const largemelon::text_loc& loc,
+			const std::string& value)
+			: ast_typed<nt::STRING_LITERAL>(loc), value_(value) {}
+		std::string_view value() const { return value_; }
+	};
+
+	/**@brief AST node for a reference to a declared name.*/
+	class ast_ident_ref : public ast_typed<nt::IDENT_REF> {
+		std::string name_;
+	public:
+		ast_ident_ref(const largemelon::text_loc& loc, const std::string& name)
+			: ast_typed<nt::IDENT_REF>(loc), name_(name) {}
+		std::string_view name() const { return name_; }
+	};
+
+	/**@brief AST node for a binary operation.*/
+	class ast_binop : public ast_typed<nt::BINOP> {
+		/**@brief Operator, e.g. @c '+' (or @c '|' for <tt>||</tt>).*/
+		char op_;
+		std::unique_ptr<ast> lexpr_;
+		std::unique_ptr<ast> rexpr_;
+	public:
+		ast_binop(const char op, ast* const lexpr, ast* const rexpr)
+			: ast_typed<nt::BINOP>(largemelon::ast_span_loc<nt>(lexpr, rexpr)),
+			  op_(op), lexpr_(lexpr), rexpr_(rexpr) {
+			add_childs(lexpr, rexpr);
+		}
+		char op() const { return op_; }
+		ast* lexpr() const { return lexpr_.get(); }
+		ast* rexpr() const { return rexpr_.get(); }
+	};
+
+	/**@brief AST node for a declaration.*/
+	class ast_decl : public ast_typed<nt::DECL> {
+		std::string name_;
+		std::unique_ptr<ast> expr_;
+	public:
+		ast_decl(const largemelon::text_loc& loc, const std::string& name,
+			ast* const expr)
+			: ast_typed<nt::DECL>(loc), name_(name), expr_(expr) {
+			add_child(expr);
+		}
+		std::string_view name() const { return name_; }
+		ast* expr() const { return expr_.get(); }
+	};
+
+	/**@brief AST node for a whole source file.*/
+	class ast_program : public ast_typed<nt::PROGRAM> {
+		std::vector< std::unique_ptr<ast> > decls_;
+	public:
+		ast_program() : ast_typed<nt::PROGRAM>(largemelon::EMPTY_TEXT_LOC) {}
+		/**@brief Appends a declaration, taking ownership of it.*/
+		void append(ast* const decl) {
+			decls_.emplace_back(decl);
+			add_child(decl);
+			set_loc(largemelon::span_loc(loc(), decl->loc()));
+		}
+		/**@brief Appends the declarations of another program, parsed from
+		 *   the text after this one's, taking ownership of them.*/
+		void graft(ast_program& other) {
+			std::move(other.decls_.begin(), other.decls_.end(),
+				std::back_inserter(decls_));
+			other.decls_.clear();
+			graft_childs(other);
+			set_loc(largemelon::span_loc(loc(), other.loc()));
+		}
+	};
+
+
+
+	/**@brief Error found while scanning or parsing.*/
+	struct diagnostic {
+		/**@brief Location of offending text.*/
+		largemelon::text_loc loc;
+		/**@brief Description of the error.*/
+		std::string message;
+	};
+
+	/**@brief Context passed between calls to the parser (as its
+	 *   <tt>@%extra_argument</tt>).*/
+	struct context {
+		/**@brief Parsed AST, if parsing succeeded.*/
+		std::unique_ptr<ast_program> root;
+		/**@brief Errors found while scanning or parsing.*/
+		std::vector<diagnostic> diagnostics;
+		/**@brief Number of tokens passed to the parser.*/
+		size_t ntokens = 0;
+		/**@brief Sink receiving each declaration as soon as it is parsed,
+		 *   instead of it being appended to @ref root, or @c nullptr. Not
+		 *   for use with @ref parse_parallel.*/
+		largemelon::ast_stream_sink<nt> *sink = nullptr;
+		/**@brief Records a syntax error at a given token.
+		 * @param token Offending token, or @c nullptr at the end of input.
+		 * @param expected Descriptions of the tokens the parser expected
+		 *   instead, if known.*/
+		void syntax_error(const largemelon::lex_token* const token,
+			const std::vector<std::string>& expected = {}) {
+			diagnostic d;
+			if (token == nullptr) {
+				d = { largemelon::EMPTY_TEXT_LOC, "unexpected end of input" };
+			}
+			else {
+				d = { token->loc, "unexpected `"
+					+ largemelon::escstr(token->mtext) + "`" };
+			}
+			for (size_t i=0; i<expected.size(); i++) {
+				d.message += (i == 0) ? ", expected " : ", ";
+				d.message += expected[i];
+			}
+			diagnostics.push_back(d);
+		}
+	};
+
+
+
+	/**@brief Scans and parses melon source text.
+	 * @param ctx Parsing context, which receives the AST and any errors.
+	 * @param data Pointer to first character of source text.
+	 * @param size Number of characters in source text.
+	 * @param fpath Path to source file, used in diagnostics.
+	 * @param verbosity Level of debug output.
+	 * @return @c 0 on success, nonzero if any error was found, even one
+	 *   the parser recovered from.*/
+	int parse(context& ctx, const char *data, size_t size,
+		const std::filesystem::path& fpath, int verbosity = 0);
+
+	/**@brief Scans and parses melon source text with an existing parser.
+	 * @param ctx Parsing context, which receives the AST and any errors.
+	 * @param pparser Parser allocated by @c MelonParseAlloc, which is passed
+	 *   the end-of-input token at the end of the text.
+	 * @param data Pointer to first character of source text.
+	 * @param size Number of characters in source text.
+	 * @param fpath Path to source file, used in diagnostics.
+	 * @param prev_loc Location of the text before @c data, such as
+	 *   @ref largemelon::FIRST_TEXT_LOC for a whole source file.
+	 * @param verbosity Level of debug output.
+	 * @return @c 0 on success, nonzero if any error was found, even one
+	 *   the parser recovered from.*/
+	int parse(context& ctx, void *pparser, const char *data, size_t size,
+		const std::filesystem::path& fpath,
+		const largemelon::text_loc& prev_loc, int verbosity = 0);
+
+	/**@brief Scans and parses melon source text on several threads at once,
+	 *   split at declarations that start a line (see
+	 *   @ref largemelon::parse_regions).
+	 * @param nthreads Number of threads, or @c 0 to use one per core.
+	 * @see @ref parse for the other parameters and the return value.*/
+	int parse_parallel(context& ctx, const char *data, size_t size,
+		const std::filesystem::path& fpath, size_t nthreads = 0,
+		int verbosity = 0);
+
+
+
+} // namespace melon
+
+
+
+// Lemon generates these, with C++ linkage, in melon_parser.cpp.
+void *MelonParseAlloc(void *(*)(size_t));
+void MelonParseFree(void *, void (*)(void *));
+void MelonParse(void *, int, largemelon::lex_token *, melon::context *);
+
+
+
+#endif // LARGEMELON_EXAMPLE_MELON_HPP
@@ -0,0 +1,127 @@
+// Lemon parser specification for the melon reference language.
+// See melon.hpp for the AST built by this parser.
+
+%name MelonParse
+%token_prefix MELON_TOK_
+
+%include {
+#include <cassert>
+#include <cstdlib>
+#include "melon.hpp"
+#include "melon_parser.h"
+
+/**@brief Description of a token ID, for "expected ..." messages.*/
+static const char *melon_token_desc(const int token_id) {
+	switch (token_id) {
+		case MELON_TOK_LOGOR: return "`||`";
+		case MELON_TOK_PLUS: return "`+`";
+		case MELON_TOK_MINUS: return "`-`";
+		case MELON_TOK_STAR: return "`*`";
+		case MELON_TOK_SLASH: return "`/`";
+		case MELON_TOK_IDENT: return "identifier";
+		case MELON_TOK_ASSIGN: return "`=`";
+		case MELON_TOK_SEMI: return "`;`";
+		case MELON_TOK_INTEGER: return "integer";
+		case MELON_TOK_TRUE: return "`true`";
+		case MELON_TOK_FALSE: return "`false`";
+		case MELON_TOK_STRING: return "string";
+		case MELON_TOK_LPAREN: return "`(`";
+		case MELON_TOK_RPAREN: return "`)`";
+		default: return "token";
+	}
+}
+}
+
+%token_type { largemelon::lex_token* }
+%token_destructor { delete $$; }
+%extra_argument { melon::context *ctx }
+
+%syntax_error {
+	std::vector<std::string> expected;
+	const auto& ids = LARGEMELON_EXPECTED_TOKEN_IDS_NEWER(yypParser);
+	for (size_t i=1; i<ids.size(); i++) {
+		if (ids[i]) {
+			expected.push_back(melon_token_desc(static_cast<int>(i)));
+		}
+	}
+	ctx->syntax_error(TOKEN, expected);
+}
+%parse_failure {
+	ctx->root.reset();
+}
+
+%left LOGOR.
+%left PLUS MINUS.
+%left STAR SLASH.
+
+%type program { melon::ast_program* }
+%destructor program { delete $$; }
+%type decl { melon::ast* }
+%destructor decl { delete $$; }
+%type expr { melon::ast* }
+%destructor expr { delete $$; }
+
+start ::= program(P). {
+	ctx->root.reset(P);
+}
+
+program(R) ::= . {
+	R = new melon::ast_program();
+}
+program(R) ::= program(L) decl(D). {
+	R = L;
+	if (ctx->sink != nullptr) {
+		ctx->sink->emit(D);
+	}
+	else {
+		R->append(D);
+	}
+}
+
+decl(R) ::= IDENT(N) ASSIGN expr(E) SEMI(S). {
+	R = new melon::ast_decl(largemelon::span_loc(N->loc, S->loc), N->mtext, E);
+	delete N;
+	delete S;
+}
+
+expr(R) ::= expr(A) LOGOR expr(B). {
+	R = new melon::ast_binop('|', A, B);
+}
+expr(R) ::= expr(A) PLUS expr(B). {
+	R = new melon::ast_binop('+', A, B);
+}
+expr(R) ::= expr(A) MINUS expr(B). {
+	R = new melon::ast_binop('-', A, B);
+}
+expr(R) ::= expr(A) STAR expr(B). {
+	R = new melon::ast_binop('*', A, B);
+}
+expr(R) ::= expr(A) SLASH expr(B). {
+	R = new melon::ast_binop('/', A, B);
+}
+expr(R) ::= LPAREN expr(E) RPAREN. {
+	R = E;
+}
+expr(R) ::= INTEGER(T). {
+	R = new melon::ast_int_literal(T->loc,
+		std::strtoll(T->mtext.c_str(), nullptr, 10));
+	delete T;
+}
+expr(R) ::= TRUE(T). {
+	R = new melon::ast_bool_literal(T->loc, true);
+	delete T;
+}
+expr(R) ::= FALSE(T). {
+	R = new melon::ast_bool_literal(T->loc, false);
+	delete T;
+}
+expr(R) ::= STRING(T). {
+	// the token includes its quotes
+	R = new melon::ast_string_literal(T->loc,
+		T->mtext.substr(1, T->mtext.size() - 2));
+	delete T;
+}
+expr(R) ::= IDENT(T). {
+	R = new melon::ast_ident_ref(T->loc, T->mtext);
+	delete T;
+}
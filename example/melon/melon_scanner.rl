@@ -0,0 +1,134 @@
+/**@file
+ * @brief Ragel scanner for the melon reference language, feeding tokens to
+ *   the Lemon-generated parser through the @c largemelon bridge functions.*/
+
+#include "melon.hpp"
+#include "melon_parser.h"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+%%{
+	machine melon_scanner;
+	access rp.;
+	variable p rp.p;
+	variable pe rp.pe;
+	variable eof rp.eof;
+
+	ident = [A-Za-z_] [A-Za-z0-9_]*;
+	string = '"' ( [^"\\\n] | '\\' any )* '"';
+
+	main := |*
+		space+                  => { skip(); };
+		'#' [^\n]*              => { skip(); };
+		'true'                  => { push(MELON_TOK_TRUE); };
+		'false'                 => { push(MELON_TOK_FALSE); };
+		ident                   => { push(MELON_TOK_IDENT); };
+		digit+                  => { push(MELON_TOK_INTEGER); };
+		string                  => { push(MELON_TOK_STRING); };
+		'||'                    => { push(MELON_TOK_LOGOR); };
+		'='                     => { push(MELON_TOK_ASSIGN); };
+		';'                     => { push(MELON_TOK_SEMI); };
+		'+'                     => { push(MELON_TOK_PLUS); };
+		'-'                     => { push(MELON_TOK_MINUS); };
+		'*'                     => { push(MELON_TOK_STAR); };
+		'/'                     => { push(MELON_TOK_SLASH); };
+		'('                     => { push(MELON_TOK_LPAREN); };
+		')'                     => { push(MELON_TOK_RPAREN); };
+	*|;
+}%%
+
+%% write data;
+
+int melon::parse(context& ctx, void *pparser, const char *data, size_t size,
+	const std::filesystem::path& fpath, const largemelon::text_loc& prev_loc,
+	int verbosity) {
+
+	largemelon::ragel_scanner_pers_type rp;
+	largemelon::lemon_parse_func_type<context> parse_func = MelonParse;
+	largemelon::text_loc loc = prev_loc;
+	const char *loc_end = data;
+	const size_t ndiagnostics = ctx.diagnostics.size();
+	std::string mtext;
+	int rc;
+
+	auto push = [&](const int token_id) {
+		largemelon::parse_token_trimmed(mtext, loc, ctx, fpath, parse_func,
+			rp.ts, rp.te, pparser, token_id, 0, 0, verbosity);
+		loc_end = rp.te;
+		ctx.ntokens++;
+	};
+	auto skip = [&]() {
+		largemelon::skip_token(mtext, loc, fpath, rp.ts, rp.te, 0, 0,
+			verbosity);
+		loc_end = rp.te;
+	};
+
+	rp.p = data;
+	rp.pe = data + size;
+	rp.eof = rp.pe;
+
+	%% write init;
+	%% write exec;
+
+	rc = 0;
+	if (rp.cs == melon_scanner_error) {
+		// from the end of the last token through the bad character, or
+		// through the end of the unterminated token
+		largemelon::text_loc eloc = largemelon::mtext_loc(loc, loc_end,
+			(rp.p < rp.pe) ? (rp.p + 1) : rp.pe);
+		if (rp.p < rp.pe) {
+			eloc.first_lno = eloc.last_lno;
+			eloc.first_cno = eloc.last_cno;
+		}
+		ctx.diagnostics.push_back({ eloc, (rp.p < rp.pe)
+			? ("unrecognized character `"
+				+ largemelon::escstr(std::string(rp.p, 1)) + "`")
+			: std::string("unterminated token at end of input") });
+		rc = 1;
+	}
+	else {
+		MelonParse(pparser, 0, nullptr, &ctx);
+		// Lemon recovers from a syntax error by discarding the bad token,
+		// so the root can still be set
+		if (! ctx.root || ctx.diagnostics.size() > ndiagnostics) {
+			rc = 1;
+		}
+	}
+	return rc;
+
+}
+
+int melon::parse(context& ctx, const char *data, size_t size,
+	const std::filesystem::path& fpath, int verbosity) {
+
+	void *pparser = MelonParseAlloc(std::malloc);
+	int rc = parse(ctx, pparser, data, size, fpath,
+		largemelon::FIRST_TEXT_LOC, verbosity);
+	MelonParseFree(pparser, std::free);
+	return rc;
+
+}
+
+int melon::parse_parallel(context& ctx, const char *data, size_t size,
+	const std::filesystem::path& fpath, size_t nthreads, int verbosity) {
+
+	return largemelon::parse_regions<context>(ctx, data, size,
+		MelonParseAlloc, MelonParseFree,
+		[&](context& c, void *pparser, const char *ts, const char *te,
+			const largemelon::text_loc& prev_loc) {
+			return parse(c, pparser, ts, te - ts, fpath, prev_loc, verbosity);
+		},
+		[](context& whole, context& part) {
+			if (! whole.root) {
+				whole.root = std::move(part.root);
+			}
+			else {
+				whole.root->graft(*part.root);
+			}
+			whole.diagnostics.insert(whole.diagnostics.end(),
+				part.diagnostics.begin(), part.diagnostics.end());
+			whole.ntokens += part.ntokens;
+		}, nthreads);
+
+}
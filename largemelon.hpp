@@ -18,18 +18,84 @@
 #define LARGEMELON_LARGEMELON_HPP
 
 #include <algorithm>
+#include <array>
+#include <bitset>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <functional>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
 #include <numeric>
-#include <regex>
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
+/**@def LARGEMELON_HAS_MMAP
+ * @brief Whether input files can be memory-mapped with POSIX @c mmap. If not,
+ *   @ref largemelon::input_buffer falls back to reading files into memory.*/
+#if defined(__unix__) || defined(__APPLE__)
+#	define LARGEMELON_HAS_MMAP 1
+#	include <cerrno>
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#else
+#	define LARGEMELON_HAS_MMAP 0
+#endif
+
+/**@def LARGEMELON_HAS_SSE2
+ * @brief Whether SSE2 intrinsics are available for the helpers that scan
+ *   text in 16-byte blocks. If not, those helpers fall back to scalar code.
+ *   Define this as @c 0 before including this header to force the scalar
+ *   code.*/
+#ifndef LARGEMELON_HAS_SSE2
+#	if defined(__SSE2__) || defined(_M_X64) \
+		|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#		define LARGEMELON_HAS_SSE2 1
+#	else
+#		define LARGEMELON_HAS_SSE2 0
+#	endif
+#endif
+#if LARGEMELON_HAS_SSE2
+#	include <emmintrin.h>
+#endif
+
+/**@def LARGEMELON_PADDED_INPUT
+ * @brief Define this as @c 1 before including this header if the text passed
+ *   to the bridge functions (e.g., @ref largemelon::parse_token_trimmed)
+ *   always comes from a @ref largemelon::input_buffer. They will then use the
+ *   @c _padded helpers, which read past the end of each token instead of
+ *   finishing with a scalar loop.*/
+#ifndef LARGEMELON_PADDED_INPUT
+#	define LARGEMELON_PADDED_INPUT 0
+#endif
+
+/**@def LARGEMELON_LF_NEWLINES
+ * @brief Define this as @c 1 before including this header if the text passed
+ *   to the bridge functions has been normalized with
+ *   @ref largemelon::normalize_newlines, so that its only newline sequence
+ *   is <tt>"\n"</tt>. They will then use the @c _lf helpers to locate
+ *   tokens.*/
+#ifndef LARGEMELON_LF_NEWLINES
+#	define LARGEMELON_LF_NEWLINES 0
+#endif
+
 /**@namespace largemelon
  * @brief Data types and functions for bridging between a Ragel-generated
  *   scanner and a Lemon-generated parser.*/
@@ -38,6 +104,15 @@ namespace largemelon {
 	
 	
 	
+	/**@brief Marks a function parameter as unused, so that it doesn't trigger
+	 *     a compilation warning. These can get numerous and cumbersome. (GCC
+	 *     has an @c unused attribute specifically for this purpose, but that
+	 *     is not implemented here.)
+	 * @param V Function parameter.*/
+	#define LARGEMELON_UNUSED_PARAM(V) do { (void)(V); } while (0);
+	
+	
+	
 	/**@brief Copy of a given string, with certain (whitespace) characters
 	 *     escaped.
 	 * @param s String.
@@ -133,6 +208,637 @@ namespace largemelon {
 	
 	
 	
+	/**@brief Edit of a text, replacing a span of characters with new ones.*/
+	struct text_edit {
+		/**@brief Offset of first character replaced.*/
+		size_t offset;
+		/**@brief Number of characters replaced.*/
+		size_t old_size;
+		/**@brief Number of characters replacing them.*/
+		size_t new_size;
+	};
+	
+	/**@brief Shift in the locations of a text after an edit (see
+	 *   @ref line_index::apply_edit).
+	 * @details Line and column numbers are those of the last position of the
+	 *   replaced characters, as in @ref text_loc::last_lno and
+	 *   @ref text_loc::last_cno, before and after the edit.*/
+	struct text_loc_delta {
+		/**@brief Line number of end of replaced characters, before edit.*/
+		size_t lno;
+		/**@brief Column number of end of replaced characters, before edit.*/
+		size_t cno;
+		/**@brief Line number of end of new characters, after edit.*/
+		size_t new_lno;
+		/**@brief Column number of end of new characters, after edit.*/
+		size_t new_cno;
+		/**@brief Whether a position at @c lno and @c cno itself is shifted,
+		 *   which is the case if any characters were replaced. (A location
+		 *   ending just before inserted characters is left as it is.)*/
+		bool inclusive;
+	};
+	
+	/**@brief Shifts a location past an edit of the text it's in.
+	 * @param loc Location, before the edit, which is updated.
+	 * @param delta Shift in locations after the edit.
+	 * @return @c true if the end of @c loc was shifted, @c false if all of
+	 *   @c loc comes before the edit.
+	 *
+	 * Each of the two positions in @c loc that comes after the end of the
+	 * replaced characters is moved by the number of lines added or removed,
+	 * and, if it is on the same line as their end, by the number of columns.
+	 * Positions before them, or within them, are left as they are.*/
+	inline bool shift_text_loc(text_loc& loc, const text_loc_delta& delta) {
+		auto shift = [&delta](size_t& lno, size_t& cno) {
+			if (lno < delta.lno || (lno == delta.lno && (cno < delta.cno
+				|| (cno == delta.cno && ! delta.inclusive)))) {
+				return false;
+			}
+			if (lno == delta.lno) {
+				cno = cno - delta.cno + delta.new_cno;
+			}
+			lno = lno - delta.lno + delta.new_lno;
+			return true;
+		};
+		shift(loc.first_lno, loc.first_cno);
+		return shift(loc.last_lno, loc.last_cno);
+	}
+	
+	
+	
+	/**@brief Number of bytes of zeroes guaranteed to follow the input text
+	 *   in an @ref input_buffer, after its NUL sentinel.
+	 * @details Helpers with a @c _padded suffix may read up to this many bytes
+	 *   past the end of the text they're given, so that they don't need a
+	 *   scalar loop for the last few bytes.*/
+	constexpr size_t INPUT_BUFFER_PADDING = 64;
+	
+	/**@brief Alignment of the input text in a heap-allocated
+	 *   @ref input_buffer. (Memory-mapped input is aligned to the system's
+	 *   page size.)*/
+	constexpr size_t INPUT_BUFFER_ALIGNMENT = 4096;
+	
+	
+	
+	/**@brief Number of bits set in an integer.
+	 * @internal This stands in for C++20's @c std::popcount.*/
+	inline unsigned bit_count(unsigned x) {
+#if defined(__GNUC__)
+		return static_cast<unsigned>(__builtin_popcount(x));
+#else
+		x = x - ((x >> 1) & 0x55555555u);
+		x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+		return (((x + (x >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+#endif
+	}
+	
+	/**@brief Position of the highest bit set in a nonzero integer.
+	 * @internal This stands in for C++20's @c std::bit_width, minus 1.*/
+	inline unsigned bit_highest(unsigned x) {
+		assert(x != 0);
+#if defined(__GNUC__)
+		return 31u - static_cast<unsigned>(__builtin_clz(x));
+#else
+		unsigned n = 0;
+		while (x >>= 1)
+			n++;
+		return n;
+#endif
+	}
+	
+	/**@brief Position of the lowest bit set in a nonzero integer.
+	 * @internal This stands in for C++20's @c std::countr_zero.*/
+	inline unsigned bit_lowest(unsigned x) {
+		assert(x != 0);
+#if defined(__GNUC__)
+		return static_cast<unsigned>(__builtin_ctz(x));
+#else
+		return bit_highest(x & (0u - x));
+#endif
+	}
+	
+	/**@brief Newline sequences found in a span of text.*/
+	struct newline_count {
+		/**@brief Number of newline sequences.*/
+		size_t count;
+		/**@brief Offset just after the last newline sequence, or @c 0 if
+		 *   there are none.*/
+		size_t tail_pos;
+	};
+	
+	/**@brief Finds the ends of newline sequences (<tt>"\r\n"</tt>,
+	 *   <tt>"\r"</tt>, or <tt>"\n"</tt>) in the 16 bytes at @c ts + @c i.
+	 * @param ts Pointer to first character of text.
+	 * @param i Offset of the block from @c ts.
+	 * @param n Number of characters in the text. Bytes at or after @c n are
+	 *   read but not counted.
+	 * @return Mask with bit @c j set if a newline sequence ends at
+	 *   <tt>ts[i+j]</tt>.
+	 * @internal A newline sequence ends at each @c '\n', and at each
+	 *   @c '\r' not followed by @c '\n' within the text. This reads 17
+	 *   bytes, so the caller has to make sure that <tt>ts[i+16]</tt> is
+	 *   readable.*/
+	inline unsigned newline_ends_block(const char *ts, const size_t i,
+		const size_t n) {
+#if LARGEMELON_HAS_SSE2
+		const __m128i lf = _mm_set1_epi8('\n');
+		const __m128i cr = _mm_set1_epi8('\r');
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ts + i));
+		__m128i b1 = _mm_loadu_si128(
+			reinterpret_cast<const __m128i *>(ts + i + 1));
+		unsigned is_lf = static_cast<unsigned>(
+			_mm_movemask_epi8(_mm_cmpeq_epi8(b, lf)));
+		unsigned is_cr = static_cast<unsigned>(
+			_mm_movemask_epi8(_mm_cmpeq_epi8(b, cr)));
+		unsigned next_lf = static_cast<unsigned>(
+			_mm_movemask_epi8(_mm_cmpeq_epi8(b1, lf)));
+#else
+		unsigned is_lf = 0, is_cr = 0, next_lf = 0;
+		for (unsigned j=0; j<16; j++) {
+			is_lf |= static_cast<unsigned>(ts[i+j] == '\n') << j;
+			is_cr |= static_cast<unsigned>(ts[i+j] == '\r') << j;
+			next_lf |= static_cast<unsigned>(ts[i+j+1] == '\n') << j;
+		}
+#endif
+		size_t rem = n - i;
+		unsigned valid = (rem >= 16) ? 0xFFFFu : ((1u << rem) - 1);
+		unsigned next_valid = (rem > 16) ? 0xFFFFu : (valid >> 1);
+		return (is_lf | (is_cr & ~(next_lf & next_valid))) & valid;
+	}
+	
+	/**@brief Counts newline sequences in the 16 bytes at @c ts + @c i.
+	 * @param nc Count to add to.
+	 * @param ts Pointer to first character of text.
+	 * @param i Offset of the block from @c ts.
+	 * @param n Number of characters in the text.
+	 * @pre Same as @ref newline_ends_block.*/
+	inline void count_newlines_block(newline_count& nc, const char *ts,
+		const size_t i, const size_t n) {
+		unsigned ends = newline_ends_block(ts, i, n);
+		if (ends != 0) {
+			nc.count += bit_count(ends);
+			nc.tail_pos = i + bit_highest(ends) + 1;
+		}
+	}
+	
+	/**@brief Counts newline sequences in a span of text.
+	 * @param ts Pointer to first character of text.
+	 * @param te Pointer to just after last character of text.
+	 * @return Number of newline sequences, and the offset just after the last
+	 *   of them.
+	 * @note A newline sequence is <tt>"\r\n"</tt> on Windows, <tt>"\r"</tt> on
+	 *   macOS, and <tt>"\n"</tt> on Unix-like OSes.*/
+	inline newline_count count_newlines(const char *ts, const char *te) {
+		assert(ts != nullptr);
+		assert(te != nullptr);
+		assert((te - ts) >= 0);
+		newline_count nc = { 0, 0 };
+		const size_t n = static_cast<size_t>(te - ts);
+		size_t i = 0;
+		for (; i+17<=n; i+=16) {
+			count_newlines_block(nc, ts, i, n);
+		}
+		for (; i<n; i++) {
+			if (ts[i] == '\n' || (ts[i] == '\r'
+				&& !((i + 1) < n && ts[i+1] == '\n'))) {
+				nc.count++;
+				nc.tail_pos = i + 1;
+			}
+		}
+		return nc;
+	}
+	
+	/**@brief Counts newline sequences in a span of text within an
+	 *   @ref input_buffer, reading past its end.
+	 * @param ts Pointer to first character of text.
+	 * @param te Pointer to just after last character of text.
+	 * @return Same as @ref count_newlines.
+	 * @pre At least 16 bytes following @c te are readable, which is always
+	 *   the case for text within an @ref input_buffer.*/
+	inline newline_count count_newlines_padded(const char *ts,
+		const char *te) {
+		assert(ts != nullptr);
+		assert(te != nullptr);
+		assert((te - ts) >= 0);
+		static_assert(INPUT_BUFFER_PADDING >= 16, "expected input buffers to "
+			"be padded for 16-byte blocks");
+		newline_count nc = { 0, 0 };
+		const size_t n = static_cast<size_t>(te - ts);
+		for (size_t i=0; i<n; i+=16) {
+			count_newlines_block(nc, ts, i, n);
+		}
+		return nc;
+	}
+	
+	/**@brief Counts @c '\n' characters in the 16 bytes at @c ts + @c i, for
+	 *   text whose newline sequences have all been rewritten to @c '\n' (see
+	 *   @ref normalize_newlines).
+	 * @param nc Count to add to.
+	 * @param ts Pointer to first character of text.
+	 * @param i Offset of the block from @c ts.
+	 * @param n Number of characters in the text. Bytes at or after @c n are
+	 *   read but not counted.
+	 * @internal Unlike @ref newline_ends_block, this only reads 16 bytes, and
+	 *   makes one comparison per byte instead of three.*/
+	inline void count_lf_block(newline_count& nc, const char *ts,
+		const size_t i, const size_t n) {
+#if LARGEMELON_HAS_SSE2
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ts + i));
+		unsigned is_lf = static_cast<unsigned>(
+			_mm_movemask_epi8(_mm_cmpeq_epi8(b, _mm_set1_epi8('\n'))));
+#else
+		unsigned is_lf = 0;
+		for (unsigned j=0; j<16; j++) {
+			is_lf |= static_cast<unsigned>(ts[i+j] == '\n') << j;
+		}
+#endif
+		size_t rem = n - i;
+		is_lf &= (rem >= 16) ? 0xFFFFu : ((1u << rem) - 1);
+		if (is_lf != 0) {
+			nc.count += bit_count(is_lf);
+			nc.tail_pos = i + bit_highest(is_lf) + 1;
+		}
+	}
+	
+	/**@brief Counts @c '\n' characters in a span of normalized text (see
+	 *   @ref normalize_newlines).
+	 * @param ts Pointer to first character of text.
+	 * @param te Pointer to just after last character of text.
+	 * @return Same as @ref count_newlines, for text without @c '\r'
+	 *   characters.*/
+	inline newline_count count_newlines_lf(const char *ts, const char *te) {
+		assert(ts != nullptr);
+		assert(te != nullptr);
+		assert((te - ts) >= 0);
+		newline_count nc = { 0, 0 };
+		const size_t n = static_cast<size_t>(te - ts);
+		size_t i = 0;
+		for (; i+16<=n; i+=16) {
+			count_lf_block(nc, ts, i, n);
+		}
+		for (; i<n; i++) {
+			if (ts[i] == '\n') {
+				nc.count++;
+				nc.tail_pos = i + 1;
+			}
+		}
+		return nc;
+	}
+	
+	/**@brief Counts @c '\n' characters in a span of normalized text within
+	 *   an @ref input_buffer, reading past its end.
+	 * @param ts Pointer to first character of text.
+	 * @param te Pointer to just after last character of text.
+	 * @return Same as @ref count_newlines_lf.
+	 * @pre Same as @ref count_newlines_padded.*/
+	inline newline_count count_newlines_lf_padded(const char *ts,
+		const char *te) {
+		assert(ts != nullptr);
+		assert(te != nullptr);
+		assert((te - ts) >= 0);
+		newline_count nc = { 0, 0 };
+		const size_t n = static_cast<size_t>(te - ts);
+		for (size_t i=0; i<n; i+=16) {
+			count_lf_block(nc, ts, i, n);
+		}
+		return nc;
+	}
+	
+	/**@brief Indent measurement policy for @ref measure_indent under which
+	 *   only spaces can indent a line, each taking one column.*/
+	struct indent_spaces {
+		/**@brief Adds the columns of a run of indent characters.
+		 * @param width Number of columns to add to.
+		 * @param seen Kinds of indent characters seen earlier in the line.
+		 * @param is_sp Mask with bit @c j set if character @c j of the run is
+		 *   a space.
+		 * @param is_tab Mask with bit @c j set if character @c j of the run is
+		 *   a tab.
+		 * @param len Number of characters in the run, each either a space or
+		 *   a tab.
+		 * @return @c 0 on success, nonzero if the run can't be part of an
+		 *   indent.*/
+		static int measure(size_t& width, unsigned& seen, const unsigned is_sp,
+			const unsigned is_tab, const unsigned len) {
+			LARGEMELON_UNUSED_PARAM(seen);
+			LARGEMELON_UNUSED_PARAM(is_sp);
+			if (is_tab != 0) {
+				return 1;
+			}
+			width += len;
+			return 0;
+		}
+	};
+	
+	/**@brief Indent measurement policy for @ref measure_indent under which
+	 *   a space takes one column and a tab takes the line to the next
+	 *   multiple of @c TabSize columns.*/
+	template <size_t TabSize>
+	struct indent_tab_stops {
+		static_assert(TabSize > 0, "expected a positive tab size");
+		/**@brief Same as @ref indent_spaces::measure.*/
+		static int measure(size_t& width, unsigned& seen, const unsigned is_sp,
+			const unsigned is_tab, const unsigned len) {
+			LARGEMELON_UNUSED_PARAM(seen);
+			if (is_sp == 0 && len > 0) {
+				// a run of only tabs, the usual case for tab-indented text
+				width = (width / TabSize + len) * TabSize;
+				return 0;
+			}
+			unsigned prev = 0;
+			for (unsigned tabs=is_tab; tabs!=0; tabs&=(tabs-1)) {
+				unsigned j = bit_lowest(tabs);
+				width += j - prev;
+				width = (width / TabSize + 1) * TabSize;
+				prev = j + 1;
+			}
+			width += len - prev;
+			return 0;
+		}
+	};
+	
+	/**@brief Indent measurement policy for @ref measure_indent under which
+	 *   a line can be indented by spaces or by tabs, but not both, with a
+	 *   space taking one column and a tab taking @c TabSize columns.*/
+	template <size_t TabSize = 8>
+	struct indent_no_mixed {
+		static_assert(TabSize > 0, "expected a positive tab size");
+		/**@brief Same as @ref indent_spaces::measure.*/
+		static int measure(size_t& width, unsigned& seen, const unsigned is_sp,
+			const unsigned is_tab, const unsigned len) {
+			LARGEMELON_UNUSED_PARAM(len);
+			seen |= (is_sp != 0 ? 1u : 0u) | (is_tab != 0 ? 2u : 0u);
+			if (seen == 3) {
+				return 1;
+			}
+			width += bit_count(is_sp) + bit_count(is_tab) * TabSize;
+			return 0;
+		}
+	};
+	
+	/**@brief Finds spaces and tabs in the 16 bytes at @c ts + @c i.
+	 * @param is_sp Mask with bit @c j set if <tt>ts[i+j]</tt> is a space.
+	 * @param is_tab Mask with bit @c j set if <tt>ts[i+j]</tt> is a tab.
+	 * @param ts Pointer to first character of text.
+	 * @param i Offset of the block from @c ts.
+	 * @param n Number of characters in the text. Bytes at or after @c n are
+	 *   read but not matched.
+	 * @pre The 16 bytes at @c ts + @c i are readable.*/
+	inline void blank_masks_block(unsigned& is_sp, unsigned& is_tab,
+		const char *ts, const size_t i, const size_t n) {
+#if LARGEMELON_HAS_SSE2
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ts + i));
+		is_sp = static_cast<unsigned>(
+			_mm_movemask_epi8(_mm_cmpeq_epi8(b, _mm_set1_epi8(' '))));
+		is_tab = static_cast<unsigned>(
+			_mm_movemask_epi8(_mm_cmpeq_epi8(b, _mm_set1_epi8('\t'))));
+#else
+		is_sp = 0;
+		is_tab = 0;
+		for (unsigned j=0; j<16; j++) {
+			is_sp |= static_cast<unsigned>(ts[i+j] == ' ') << j;
+			is_tab |= static_cast<unsigned>(ts[i+j] == '\t') << j;
+		}
+#endif
+		size_t rem = n - i;
+		unsigned valid = (rem >= 16) ? 0xFFFFu : ((1u << rem) - 1);
+		is_sp &= valid;
+		is_tab &= valid;
+	}
+	
+	/**@brief Measures the leading run of spaces and tabs in up to 16
+	 *   characters, as found by @ref blank_masks_block.
+	 * @param width Number of columns to add to.
+	 * @param size Number of characters to add to.
+	 * @param seen Kinds of indent characters seen earlier in the line.
+	 * @param is_sp Mask of spaces.
+	 * @param is_tab Mask of tabs.
+	 * @return @c 0 if the indent ends within the block, @c 1 if it might
+	 *   continue into the next block, or @c -1 if @c IndentPolicy rejects it.*/
+	template <typename IndentPolicy>
+	inline int measure_indent_block(size_t& width, size_t& size,
+		unsigned& seen, const unsigned is_sp, const unsigned is_tab) {
+		const unsigned len = bit_lowest(~(is_sp | is_tab) | 0x10000u);
+		const unsigned run = (1u << len) - 1;
+		if (IndentPolicy::measure(width, seen, is_sp & run, is_tab & run, len)
+			!= 0) {
+			return -1;
+		}
+		size += len;
+		return (len == 16) ? 1 : 0;
+	}
+	
+	/**@brief Measures a line's indent, i.e., its leading spaces and tabs.
+	 * @tparam IndentPolicy How spaces and tabs are measured:
+	 *   @ref indent_spaces, @ref indent_tab_stops, or
+	 *   @ref indent_no_mixed.
+	 * @param width Number of columns occupied by the indent, as might be
+	 *   passed on to @ref block_indent_tracker::update.
+	 * @param size Number of characters in the indent.
+	 * @param ls Pointer to first character of line.
+	 * @param te Pointer to just after last character of text.
+	 * @return @c 0 on success, nonzero if @c IndentPolicy rejects the indent.
+	 * 
+	 * The indent is scanned 16 characters at a time. It ends at the first
+	 * character other than a space or tab, so @c te can be the end of the
+	 * whole text rather than of the line.*/
+	template <typename IndentPolicy>
+	inline int measure_indent(size_t& width, size_t& size, const char *ls,
+		const char *te) {
+		assert(ls != nullptr);
+		assert(te != nullptr);
+		assert((te - ls) >= 0);
+		width = 0;
+		size = 0;
+		const size_t n = static_cast<size_t>(te - ls);
+		unsigned seen = 0;
+		int more = 1;
+		size_t i = 0;
+		for (; more>0 && i+16<=n; i+=16) {
+			unsigned is_sp, is_tab;
+			blank_masks_block(is_sp, is_tab, ls, i, n);
+			more = measure_indent_block<IndentPolicy>(width, size, seen,
+				is_sp, is_tab);
+		}
+		if (more > 0 && i < n) {
+			unsigned is_sp = 0, is_tab = 0;
+			for (unsigned j=0; i+j<n; j++) {
+				is_sp |= static_cast<unsigned>(ls[i+j] == ' ') << j;
+				is_tab |= static_cast<unsigned>(ls[i+j] == '\t') << j;
+			}
+			more = measure_indent_block<IndentPolicy>(width, size, seen,
+				is_sp, is_tab);
+		}
+		return (more < 0) ? 1 : 0;
+	}
+	
+	/**@brief Measures a line's indent within an @ref input_buffer, reading
+	 *   past the end of the text.
+	 * @tparam IndentPolicy Same as @ref measure_indent.
+	 * @param width Same as @ref measure_indent.
+	 * @param size Same as @ref measure_indent.
+	 * @param ls Pointer to first character of line.
+	 * @param te Pointer to just after last character of text.
+	 * @return Same as @ref measure_indent.
+	 * @pre Same as @ref count_newlines_padded.*/
+	template <typename IndentPolicy>
+	inline int measure_indent_padded(size_t& width, size_t& size,
+		const char *ls, const char *te) {
+		assert(ls != nullptr);
+		assert(te != nullptr);
+		assert((te - ls) >= 0);
+		width = 0;
+		size = 0;
+		const size_t n = static_cast<size_t>(te - ls);
+		unsigned seen = 0;
+		int more = 1;
+		for (size_t i=0; more>0 && i<n; i+=16) {
+			unsigned is_sp, is_tab;
+			blank_masks_block(is_sp, is_tab, ls, i, n);
+			more = measure_indent_block<IndentPolicy>(width, size, seen,
+				is_sp, is_tab);
+		}
+		return (more < 0) ? 1 : 0;
+	}
+	
+	/**@brief Mapping from offsets and locations in a normalized text back to
+	 *   those in the original text, as recorded by @ref normalize_newlines.
+	 * @details Only what was removed is recorded: nothing at all for a text
+	 *   with @c '\n' newlines and no byte order mark, and one offset per
+	 *   <tt>"\r\n"</tt> sequence otherwise.*/
+	struct newline_map {
+		/**@brief Number of bytes of byte order mark stripped from the start
+		 *   of the text (@c 0 or @c 3).*/
+		size_t bom_size = 0;
+		/**@brief Offset in the normalized text of the @c '\n' of each
+		 *   <tt>"\r\n"</tt> sequence, whose @c '\r' was removed, in
+		 *   increasing order.*/
+		std::vector<size_t> crlf_offsets;
+		/**@brief Offset in the original text of a character in the
+		 *   normalized text.
+		 * @param offset Offset of a character in the normalized text, or of
+		 *   just after the last one.*/
+		size_t original_offset(const size_t offset) const {
+			return offset + bom_size + static_cast<size_t>(std::upper_bound(
+				crlf_offsets.begin(), crlf_offsets.end(), offset)
+				- crlf_offsets.begin());
+		}
+		/**@brief Location in the original text of text in the normalized
+		 *   text.
+		 * @param loc Location found in the normalized text, as by
+		 *   @ref mtext_loc_lf.
+		 * @return Same as @ref mtext_loc for the original text.
+		 * @details Line numbers are the same, since each newline sequence is
+		 *   now a single @c '\n', and so are column numbers, since a removed
+		 *   @c '\r' only ever ended a line, except on the first line after a
+		 *   stripped byte order mark.*/
+		text_loc original_loc(const text_loc& loc) const {
+			text_loc orig = loc;
+			if (orig.first_lno == 1) {
+				orig.first_cno += bom_size;
+			}
+			if (orig.last_lno == 1) {
+				orig.last_cno += bom_size;
+			}
+			return orig;
+		}
+	};
+	
+	/**@brief Strips a UTF-8 byte order mark from a text and rewrites its
+	 *   <tt>"\r\n"</tt> and <tt>"\r"</tt> newline sequences to @c '\n', so
+	 *   that @ref mtext_loc_lf can be used on it instead of @ref mtext_loc.
+	 * @param src Pointer to first character of text.
+	 * @param size Number of characters in text.
+	 * @param dst Pointer to memory for at least @c size characters of
+	 *   normalized text, which may be @c src itself.
+	 * @param map Mapping back to the original text, which is replaced.
+	 * @return Number of characters in normalized text, at most @c size.
+	 * @details Runs of 16 bytes without a @c '\r' are copied whole (or left
+	 *   in place, if nothing has been removed yet).*/
+	inline size_t normalize_newlines(const char *src, const size_t size,
+		char *dst, newline_map& map) {
+		assert(src != nullptr);
+		assert(dst != nullptr);
+		map.bom_size = 0;
+		map.crlf_offsets.clear();
+		size_t r = 0;
+		size_t w = 0;
+		if (size >= 3 && static_cast<unsigned char>(src[0]) == 0xEF
+			&& static_cast<unsigned char>(src[1]) == 0xBB
+			&& static_cast<unsigned char>(src[2]) == 0xBF) {
+			map.bom_size = r = 3;
+		}
+		while (r < size) {
+#if LARGEMELON_HAS_SSE2
+			const __m128i cr = _mm_set1_epi8('\r');
+			for (; r+16<=size; r+=16, w+=16) {
+				__m128i b = _mm_loadu_si128(
+					reinterpret_cast<const __m128i *>(src + r));
+				if (_mm_movemask_epi8(_mm_cmpeq_epi8(b, cr)) != 0) {
+					break;
+				}
+				if (dst + w != src + r) {
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + w), b);
+				}
+			}
+#endif
+			for (const size_t stop=std::min(size, r + 16); r<stop; r++) {
+				char c = src[r];
+				if (c == '\r') {
+					if (r + 1 < size && src[r+1] == '\n') {
+						map.crlf_offsets.push_back(w);
+						continue;
+					}
+					c = '\n';
+				}
+				dst[w++] = c;
+			}
+		}
+		return w;
+	}
+	
+	
+	
+	/**@brief Location of a span of text following a previous location, given
+	 *   the newline sequences found in that text.
+	 * @param prev_loc Location of text previous to the span.
+	 * @param nc Newline sequences in the span.
+	 * @param len Number of characters in the span.*/
+	inline text_loc mtext_loc_after(const text_loc &prev_loc,
+		const newline_count &nc, const size_t len) {
+		text_loc loc;
+		
+		// The new location starts just after the last position in `prev_loc`.
+		
+		loc.first_lno = prev_loc.last_lno;
+		loc.first_cno = prev_loc.last_cno + 1;
+			// what if this is past all characters on line?
+			// if it is, then the newline sequence is coming up and that
+			// erroneous extra column won't matter;
+			// write unit tests to confirm this
+		
+		// The number of lines spanned by the new location is equal to the
+		// number of newline character sequences in the text.
+		//
+		// If any newlines were encountered in the text, then the column number
+		// of the last position spanned by the new location is equal to the
+		// number of positions from the last newline in the text to its end.
+		//
+		// If no newlines were encountered, then the column number of the new
+		// location is simply the value of the previous location's last
+		// position plus the number of positions in the text.
+		
+		loc.last_lno = loc.first_lno + nc.count;
+		if (nc.count > 0) {
+			loc.last_cno = len - nc.tail_pos;
+		}
+		else {
+			loc.last_cno = prev_loc.last_cno + len;
+		}
+		
+		return loc;
+	}
+	
 	/**@brief Location of a given text string in a larger string being parsed.
 	 * @param prev_loc Location of text previous to @c mtext.
 	 * @param mtext Text for which location is calculated.
@@ -148,7 +854,6 @@ namespace largemelon {
 	 *     @c prev_loc.
 	 * @todo Document @ref mtext_loc() with an illustration of lines and column
 	 *     numbers (e.g. with column @c 0 before the line).
-	 * @todo Performance might be boosted by reimplementing without regexes.
 	 * 
 	 * @code{.cpp}
 	 * text_loc prev_loc = {1, 26, 1, 29};
@@ -159,55 +864,199 @@ namespace largemelon {
 	 */
 	inline text_loc mtext_loc(const text_loc &prev_loc,
 		const std::string &mtext) {
-		
-		static const std::regex RGX_NL = std::regex(R"(\r\n|\r|\n)");
-		std::sregex_iterator nli, rend;
-		text_loc loc;
-		size_t num_newlines;
-		size_t tpos;
-		
-		// The new location starts just after the last position in `prev_loc`.
-		
-		loc.first_lno = prev_loc.last_lno;
-		loc.first_cno = prev_loc.last_cno + 1;
-			// what if this is past all characters on line?
-			// if it is, then the newline sequence is coming up and that
-			// erroneous extra column won't matter;
-			// write unit tests to confirm this
-		
-		// The number of lines spanned by the new location is equal to the
-		// number of newline character sequences in `mtext`.
-		
-		num_newlines = 0;
-		tpos = 0;
-		nli = std::sregex_iterator(mtext.cbegin(), mtext.cend(), RGX_NL);
-		rend = std::sregex_iterator();
-		for (; nli!=rend; nli++) {
-			num_newlines++;
-			tpos = nli->position(0) + nli->length(0);
-		}
-		
-		// If any newlines were encountered in `mtext`, then the column number
-		// of the last position spanned by the new location is equal to the
-		// number of positions from the last newline in `mtext` to the end of
-		// `mtext`.
-		//
-		// If no newlines were encountered, then the column number of the new
-		// location is simply the value of the previous location's last
-		// position plus the number of positions in `mtext`.
-		
-		loc.last_lno = loc.first_lno + num_newlines;
-		if (num_newlines > 0) {
-			loc.last_cno = mtext.length() - tpos;
+		return mtext_loc_after(prev_loc,
+			count_newlines(mtext.data(), mtext.data() + mtext.size()),
+			mtext.size());
+	}
+	
+	/**@brief Location of the text between two pointers, following a previous
+	 *   location.
+	 * @param prev_loc Location of text previous to the text at @c ts.
+	 * @param ts Pointer to first character of text.
+	 * @param te Pointer to just after last character of text.
+	 * @return Same as <tt>mtext_loc(prev_loc, toktext(ts, te))</tt>, without
+	 *   copying the text.*/
+	inline text_loc mtext_loc(const text_loc &prev_loc, const char *ts,
+		const char *te) {
+		return mtext_loc_after(prev_loc, count_newlines(ts, te),
+			static_cast<size_t>(te - ts));
+	}
+	
+	/**@brief Location of the text between two pointers within an
+	 *   @ref input_buffer, following a previous location.
+	 * @param prev_loc Location of text previous to the text at @c ts.
+	 * @param ts Pointer to first character of text.
+	 * @param te Pointer to just after last character of text.
+	 * @return Same as @ref mtext_loc.
+	 * @pre Same as @ref count_newlines_padded.*/
+	inline text_loc mtext_loc_padded(const text_loc &prev_loc,
+		const char *ts, const char *te) {
+		return mtext_loc_after(prev_loc, count_newlines_padded(ts, te),
+			static_cast<size_t>(te - ts));
+	}
+	
+	/**@brief Location of the text between two pointers in a normalized text
+	 *   (see @ref normalize_newlines), following a previous location.
+	 * @param prev_loc Location of text previous to the text at @c ts.
+	 * @param ts Pointer to first character of text.
+	 * @param te Pointer to just after last character of text.
+	 * @return Same as @ref mtext_loc, for text without @c '\r' characters.*/
+	inline text_loc mtext_loc_lf(const text_loc &prev_loc, const char *ts,
+		const char *te) {
+		return mtext_loc_after(prev_loc, count_newlines_lf(ts, te),
+			static_cast<size_t>(te - ts));
+	}
+	
+	/**@brief Location of the text between two pointers within a normalized
+	 *   @ref input_buffer (see @ref input_buffer::normalize_newlines),
+	 *   following a previous location.
+	 * @param prev_loc Location of text previous to the text at @c ts.
+	 * @param ts Pointer to first character of text.
+	 * @param te Pointer to just after last character of text.
+	 * @return Same as @ref mtext_loc_lf.
+	 * @pre Same as @ref count_newlines_padded.*/
+	inline text_loc mtext_loc_lf_padded(const text_loc &prev_loc,
+		const char *ts, const char *te) {
+		return mtext_loc_after(prev_loc, count_newlines_lf_padded(ts, te),
+			static_cast<size_t>(te - ts));
+	}
+	
+	/**@brief Appends the offsets at which lines start in a span of text.
+	 * @param line_starts Offsets to append to.
+	 * @param ts Pointer to first character of text.
+	 * @param te Pointer to just after last character of text.
+	 * @param offset Offset of @c ts in the whole text.
+	 * 
+	 * A line starts just after each newline sequence, as counted by
+	 * @ref count_newlines. A <tt>"\r\n"</tt> sequence mustn't be split
+	 * between spans.*/
+	inline void find_line_starts(std::vector<size_t>& line_starts,
+		const char *ts, const char *te, const size_t offset) {
+		assert(ts != nullptr);
+		assert(te != nullptr);
+		assert((te - ts) >= 0);
+		const size_t n = static_cast<size_t>(te - ts);
+		size_t i = 0;
+		for (; i+17<=n; i+=16) {
+			for (unsigned ends=newline_ends_block(ts, i, n); ends!=0;
+				ends&=ends-1) {
+				line_starts.push_back(offset + i
+					+ bit_lowest(ends) + 1);
+			}
 		}
-		else {
-			loc.last_cno = prev_loc.last_cno + mtext.length();
+		for (; i<n; i++) {
+			if (ts[i] == '\n' || (ts[i] == '\r'
+				&& !((i + 1) < n && ts[i+1] == '\n'))) {
+				line_starts.push_back(offset + i + 1);
+			}
 		}
-		
-		return loc;
-		
 	}
 	
+	/**@brief Index of the lines in a text, mapping character offsets to
+	 *   locations.
+	 * @details Locations are the same as those that @ref mtext_loc gives when
+	 *   it is called for every token from the start of the text, except that a
+	 *   <tt>"\r\n"</tt> sequence split between two tokens counts as a single
+	 *   newline. That lets tokens be matched out of order, as by
+	 *   @ref speculative_lex, and located afterward.*/
+	class line_index {
+		/**@brief Offset at which each line starts, the first being @c 0.*/
+		std::vector<size_t> line_starts_;
+	public:
+		/**@brief Constructor for an empty text.*/
+		line_index() : line_starts_{ 0 } {}
+		/**@brief Constructor.
+		 * @param data Pointer to first character of text.
+		 * @param size Number of characters in text.*/
+		line_index(const char *data, const size_t size) : line_starts_{ 0 } {
+			find_line_starts(line_starts_, data, data + size, 0);
+		}
+		/**@brief Constructor from line starts, as found by
+		 *   @ref find_line_starts.
+		 * @param line_starts Offset at which each line starts, in increasing
+		 *   order, the first being @c 0.*/
+		explicit line_index(std::vector<size_t> line_starts)
+			: line_starts_(std::move(line_starts)) {
+			assert(! line_starts_.empty() && line_starts_[0] == 0);
+		}
+		/**@brief Number of lines.*/
+		size_t line_count() const { return line_starts_.size(); }
+		/**@brief Line number at a character offset.
+		 * @param offset Character offset, which may be just after the last
+		 *   character.*/
+		size_t lno(const size_t offset) const {
+			return static_cast<size_t>(std::upper_bound(line_starts_.begin(),
+				line_starts_.end(), offset) - line_starts_.begin());
+		}
+		/**@brief Location of the text between two character offsets.
+		 * @param begin Offset of first character of text.
+		 * @param end Offset just after last character of text.
+		 * @return Same as @ref mtext_loc for the text, following the text
+		 *   before it.*/
+		text_loc loc(const size_t begin, const size_t end) const {
+			assert(begin <= end);
+			text_loc loc;
+			loc.first_lno = lno(begin);
+			loc.first_cno = begin - line_starts_[loc.first_lno - 1] + 1;
+			loc.last_lno = lno(end);
+			loc.last_cno = end - line_starts_[loc.last_lno - 1];
+			return loc;
+		}
+		/**@brief Character offset at a line and column number.
+		 * @param lno Line number.
+		 * @param cno Column number, or @c 0 for the start of the line.
+		 * @return Offset just after the character at @c cno, so that
+		 *   <tt>offset(loc.last_lno, loc.last_cno)</tt> is the end of a
+		 *   location and <tt>offset(loc.first_lno, loc.first_cno) - 1</tt> is
+		 *   its start.*/
+		size_t offset(const size_t lno, const size_t cno) const {
+			assert(lno >= 1 && lno <= line_starts_.size());
+			return line_starts_[lno - 1] + cno;
+		}
+		/**@brief Updates the index for an edit of the text, finding lines
+		 *   only in the new characters.
+		 * @param data Pointer to first character of text, after the edit.
+		 * @param size Number of characters in text, after the edit.
+		 * @param edit Edit made to the text.
+		 * @return Shift in locations after the edit, for
+		 *   @ref shift_text_loc.*/
+		text_loc_delta apply_edit(const char *data, const size_t size,
+			const text_edit& edit) {
+			const size_t old_end = edit.offset + edit.old_size;
+			const size_t new_end = edit.offset + edit.new_size;
+			assert(new_end <= size);
+			text_loc_delta delta;
+			delta.lno = lno(old_end);
+			delta.cno = old_end - line_starts_[delta.lno - 1];
+			delta.inclusive = (edit.old_size > 0);
+			
+			// Lines may start anywhere from the replaced characters to just
+			// after them, where the character before the edit may or may not
+			// end a "\r\n" sequence now.
+			
+			std::vector<size_t> found;
+			const size_t from = (edit.offset > 0) ? edit.offset - 1 : 0;
+			find_line_starts(found, data + from, data + new_end, from);
+			if (! found.empty() && found.back() == new_end
+				&& data[new_end - 1] == '\r' && new_end < size
+				&& data[new_end] == '\n') {
+				found.pop_back();
+			}
+			auto first = std::lower_bound(line_starts_.begin() + 1,
+				line_starts_.end(), edit.offset);
+			auto last = std::upper_bound(first, line_starts_.end(), old_end);
+			for (auto i=last; i!=line_starts_.end(); i++) {
+				*i = *i - edit.old_size + edit.new_size;
+			}
+			line_starts_.insert(line_starts_.erase(first, last), found.begin(),
+				found.end());
+			
+			delta.new_lno = lno(new_end);
+			delta.new_cno = new_end - line_starts_[delta.new_lno - 1];
+			return delta;
+		}
+	};
+	
 	
 	
 	/**@brief Line number at beginning of text span.
@@ -270,14 +1119,20 @@ namespace largemelon {
 				});
 	}
 	
-	
-	
-	/**@brief Marks a function parameter as unused, so that it doesn't trigger
-	 *     a compilation warning. These can get numerous and cumbersome. (GCC
-	 *     has an @c unused attribute specifically for this purpose, but that
-	 *     is not implemented here.)
-	 * @param V Function parameter.*/
-	#define LARGEMELON_UNUSED_PARAM(V) do { (void)(V); } while (0);
+	/**@brief Whether a text location spans all of another.
+	 * @param outer Location of enclosing text span.
+	 * @param inner Location of enclosed text span.
+	 * @return @c true if @c outer starts at or before @c inner and ends at or
+	 *   after it, @c false otherwise.*/
+	inline constexpr bool span_loc_contains(const text_loc &outer,
+		const text_loc &inner) {
+		return (outer.first_lno < inner.first_lno
+				|| (outer.first_lno == inner.first_lno
+					&& outer.first_cno <= inner.first_cno))
+			&& (outer.last_lno > inner.last_lno
+				|| (outer.last_lno == inner.last_lno
+					&& outer.last_cno >= inner.last_cno));
+	}
 	
 	
 	
@@ -391,38 +1246,423 @@ namespace largemelon {
 	 *   parser generator.*/
 	using lemon_parsetrace_func_type = std::function<void(FILE *, char *)>;
 	
+	/**@brief Data type for a function pointer with function signature matching
+	 *   that of the <tt>ParseInit()</tt>-like function generated by the Lemon
+	 *   parser generator, which initializes a parser in memory that's already
+	 *   allocated.
+	 * @note If the parser specification has an <tt>@%extra_context</tt>
+	 *   directive, <tt>ParseInit()</tt> takes the context as well, and has to
+	 *   be wrapped in a lambda to match this.*/
+	using lemon_parseinit_func_type = std::function<void(void *)>;
 	
+	/**@brief Data type for a function pointer with function signature matching
+	 *   that of the <tt>ParseFinalize()</tt>-like function generated by the
+	 *   Lemon parser generator, which clears a parser's stack (calling the
+	 *   destructors of anything left on it) without freeing the parser.*/
+	using lemon_parsefinalize_func_type = std::function<void(void *)>;
 	
-	/**@brief Sets the matched text and current location in text for a single
-	 *     parsing step.
-	 * @param mtext Matched text, extracted from parsed text.
-	 * @param loc Location of matched text, relative to parsed text.
-	 * @param fpath Path to file being parsed.
-	 * @param ts Pointer to position of first matched character in parsed text.
-	 * @param te Pointer to position just after last matched character in
-	 *     parsed text.
-	 * @param ltrim Number of characters to trim from the front of the parsed
-	 *     text, starting from @c ts.
-	 * @param rtrim Number of characters to trim from the end of the parsed
-	 *     text, starting from @c te.
+	
+	
+	/**@brief Pool of Lemon-generated parsers, which hands finished parsers
+	 *   on to the next parse instead of freeing them and allocating new ones.
+	 * @details A parser given back to the pool is reset by
+	 *   <tt>ParseFinalize()</tt> and <tt>ParseInit()</tt>, if they were given,
+	 *   keeping the parser's memory (and, if it has grown, its stack),
+	 *   however its parse ended. If they weren't given, the parser has to be
+	 *   back in its initial state when it is given back, which a
+	 *   Lemon-generated parser is once it has been passed the end-of-input
+	 *   token (@c 0); a parser whose parse failed, which may have stopped
+	 *   short of that, is freed instead (see @ref lease::fail).
 	 * 
-	 * The values of @c ltrim and @c rtrim do not affect the resultant value of
-	 * @c loc, because those characters are still being consumed by the parsing
-	 * step.*/
-	inline void set_mtext_and_loc_trimmed(std::string& mtext, text_loc& loc,
-		const std::filesystem::path& fpath, const char *ts, const char *te,
-		const size_t& ltrim, const size_t& rtrim) {
-		LARGEMELON_UNUSED_PARAM(fpath);
-		assert(ts != nullptr);
-		assert(te != nullptr);
-		assert((te - rtrim) - (ts + ltrim) > 0);
-		mtext = toktext(ts + ltrim, te - rtrim);
-		loc = mtext_loc(loc, toktext(ts, te));
-	}
+	 * A pool is not thread-safe; use one per thread.
+	 * @code{.cpp}
+	 * largemelon::lemon_parser_pool pool(ParseAlloc, ParseFree, ParseInit,
+	 *   ParseFinalize);
+	 * for (auto& fpath: fpaths) {
+	 *   largemelon::lemon_parser_pool::lease parser(pool);
+	 *   scan_and_parse(ctx, parser.get(), fpath);
+	 * }
+	 * @endcode*/
+	class lemon_parser_pool {
+		/**@brief <tt>ParseAlloc()</tt>-like function.*/
+		lemon_parsealloc_func_type parsealloc_;
+		/**@brief <tt>ParseFree()</tt>-like function.*/
+		lemon_parsefree_func_type parsefree_;
+		/**@brief <tt>ParseInit()</tt>-like function, or empty.*/
+		lemon_parseinit_func_type parseinit_;
+		/**@brief <tt>ParseFinalize()</tt>-like function, or empty.*/
+		lemon_parsefinalize_func_type parsefinalize_;
+		/**@brief Parsers waiting to be handed out.*/
+		std::vector<void *> idle_;
+		/**@brief Number of parsers allocated so far.*/
+		size_t nallocs_;
+	public:
+		/**@brief Parser handed out by a pool, and given back to it when this
+		 *   is destroyed.*/
+		class lease {
+			lemon_parser_pool& pool_;
+			void *pparser_;
+			bool failed_;
+		public:
+			/**@brief Constructor.
+			 * @param pool Pool to take a parser from.*/
+			explicit lease(lemon_parser_pool& pool) : pool_(pool),
+				pparser_(pool.acquire()), failed_(false) {}
+			lease(const lease&) = delete;
+			lease& operator=(const lease&) = delete;
+			/**@brief Destructor.*/
+			~lease() { pool_.release(pparser_, failed_); }
+			/**@brief Pointer to the parser.*/
+			void *get() const { return pparser_; }
+			/**@brief Marks the parse as failed, so that the parser may
+			 *   have been left partway through it.*/
+			void fail() { failed_ = true; }
+		};
+		
+		/**@brief Constructor.
+		 * @param parsealloc <tt>ParseAlloc()</tt>-like function.
+		 * @param parsefree <tt>ParseFree()</tt>-like function.
+		 * @param parseinit <tt>ParseInit()</tt>-like function, or empty.
+		 * @param parsefinalize <tt>ParseFinalize()</tt>-like function, or
+		 *   empty.*/
+		lemon_parser_pool(lemon_parsealloc_func_type parsealloc,
+			lemon_parsefree_func_type parsefree,
+			lemon_parseinit_func_type parseinit = nullptr,
+			lemon_parsefinalize_func_type parsefinalize = nullptr)
+			: parsealloc_(std::move(parsealloc)),
+			parsefree_(std::move(parsefree)), parseinit_(std::move(parseinit)),
+			parsefinalize_(std::move(parsefinalize)), idle_(), nallocs_(0) {
+			assert(static_cast<bool>(parseinit_)
+				== static_cast<bool>(parsefinalize_));
+		}
+		lemon_parser_pool(const lemon_parser_pool&) = delete;
+		lemon_parser_pool& operator=(const lemon_parser_pool&) = delete;
+		/**@brief Move constructor.*/
+		lemon_parser_pool(lemon_parser_pool&& other) noexcept
+			: parsealloc_(std::move(other.parsealloc_)),
+			parsefree_(std::move(other.parsefree_)),
+			parseinit_(std::move(other.parseinit_)),
+			parsefinalize_(std::move(other.parsefinalize_)),
+			idle_(std::move(other.idle_)), nallocs_(other.nallocs_) {
+			other.idle_.clear();
+		}
+		/**@brief Destructor, which frees the idle parsers.
+		 * @warning Every parser handed out must have been given back.*/
+		~lemon_parser_pool() {
+			for (void *pparser: idle_) {
+				parsefree_(pparser, std::free);
+			}
+		}
+		/**@brief Hands out an idle parser, allocating one if there are none.
+		 * @return Parser in its initial state.*/
+		void *acquire() {
+			if (idle_.empty()) {
+				nallocs_++;
+				void *pparser = parsealloc_(std::malloc);
+				assert(pparser != nullptr);
+				return pparser;
+			}
+			void *pparser = idle_.back();
+			idle_.pop_back();
+			return pparser;
+		}
+		/**@brief Takes back a parser handed out by @ref acquire, resetting
+		 *   it for the next parse.
+		 * @param pparser Parser.
+		 * @param failed Whether the parse failed, so that the parser may
+		 *   have been left partway through it. Without
+		 *   <tt>ParseFinalize()</tt> and <tt>ParseInit()</tt> to reset it,
+		 *   such a parser is freed rather than handed out again.*/
+		void release(void *const pparser, const bool failed = false) {
+			assert(pparser != nullptr);
+			if (parsefinalize_) {
+				parsefinalize_(pparser);
+				parseinit_(pparser);
+			}
+			else if (failed) {
+				parsefree_(pparser, std::free);
+				return;
+			}
+			idle_.push_back(pparser);
+		}
+		/**@brief Number of parsers allocated so far.*/
+		size_t nallocs() const { return nallocs_; }
+	};
 	
 	
 	
-	/**@brief Skips a token matched by a single parsing step.
+	/**@brief Arena that a thread's parsers, tokens, and AST nodes can be
+	 *   allocated from together, and freed all at once.
+	 * @details Memory comes from a @c std::pmr::monotonic_buffer_resource:
+	 *   allocating is a pointer bump, freeing single blocks does nothing, and
+	 *   @ref release frees everything. The resource is available through
+	 *   @ref resource for @c std::pmr containers and allocators, such as for
+	 *   tokens and AST nodes. A Lemon-generated parser is allocated from it
+	 *   through @ref arena_malloc, which uses the arena made current for the
+	 *   calling thread by a @ref lemon_parser_session.
+	 * 
+	 * An arena is not thread-safe; use one per thread.*/
+	class parse_arena {
+		/**@brief Memory resource handing out the arena's memory.*/
+		std::pmr::monotonic_buffer_resource resource_;
+		/**@brief Number of bytes allocated through @ref allocate.*/
+		size_t nbytes_;
+	public:
+		/**@brief Constructor.
+		 * @param initial_size Size of the first block of memory to be taken
+		 *   from the heap. Later blocks grow geometrically.*/
+		explicit parse_arena(const size_t initial_size = 64 * 1024)
+			: resource_(initial_size), nbytes_(0) {}
+		parse_arena(const parse_arena&) = delete;
+		parse_arena& operator=(const parse_arena&) = delete;
+		/**@brief Memory resource for @c std::pmr containers and allocators.*/
+		std::pmr::memory_resource *resource() { return &resource_; }
+		/**@brief Allocates memory aligned for any scalar type.
+		 * @param size Number of bytes.
+		 * @return Allocated memory, or @c nullptr if out of memory.*/
+		void *allocate(const size_t size) noexcept {
+			try {
+				void *mem = resource_.allocate(size,
+					alignof(std::max_align_t));
+				nbytes_ += size;
+				return mem;
+			}
+			catch (const std::bad_alloc&) {
+				return nullptr;
+			}
+		}
+		/**@brief Frees all memory allocated from this arena.
+		 * @warning Nothing allocated from this arena may be used after
+		 *   this.*/
+		void release() {
+			resource_.release();
+			nbytes_ = 0;
+		}
+		/**@brief Number of bytes allocated through @ref allocate (and so
+		 *   through @ref arena_malloc) since construction or the last
+		 *   @ref release.*/
+		size_t bytes_allocated() const { return nbytes_; }
+		/**@brief Arena current for the calling thread, used by
+		 *   @ref arena_malloc, or @c nullptr if none is.*/
+		static parse_arena *&current() {
+			thread_local parse_arena *arena = nullptr;
+			return arena;
+		}
+	};
+	
+	/**@brief Header preceding each block of memory handed out by
+	 *   @ref arena_malloc.*/
+	struct alignas(std::max_align_t) arena_block_header {
+		/**@brief Number of usable bytes in the block.*/
+		size_t size;
+		/**@brief Arena the block came from, or @c nullptr for the heap.*/
+		parse_arena *arena;
+	};
+	
+	/**@brief Allocates memory from the calling thread's current
+	 *   @ref parse_arena, falling back to the heap if there is none.
+	 * @details This matches @ref malloc_func_type, so it can be passed to a
+	 *   <tt>ParseAlloc()</tt>-like function. To have a parser's growable stack
+	 *   (<tt>YYSTACKDEPTH <= 0</tt>) come from the arena too, add this to the
+	 *   Lemon parser specification:
+	 * @code{.cpp}
+	 * %include {
+	 * #define YYREALLOC largemelon::arena_realloc
+	 * #define YYFREE largemelon::arena_free
+	 * }
+	 * @endcode
+	 * @param size Number of bytes.
+	 * @return Memory aligned for any scalar type, or @c nullptr if out of
+	 *   memory.*/
+	inline void *arena_malloc(const size_t size) noexcept {
+		parse_arena *arena = parse_arena::current();
+		size_t n = sizeof(arena_block_header) + size;
+		void *mem = (arena != nullptr) ? arena->allocate(n) : std::malloc(n);
+		if (mem == nullptr) {
+			return nullptr;
+		}
+		return new (mem) arena_block_header{ size, arena } + 1;
+	}
+	
+	/**@brief Frees memory allocated by @ref arena_malloc. Memory from an
+	 *   arena is only actually freed when the arena is released.
+	 * @details This matches @ref free_func_type, so it can be passed to a
+	 *   <tt>ParseFree()</tt>-like function.
+	 * @param mem Allocated memory, or @c nullptr.*/
+	inline void arena_free(void *const mem) noexcept {
+		if (mem == nullptr) {
+			return;
+		}
+		arena_block_header *header = static_cast<arena_block_header *>(mem)
+			- 1;
+		if (header->arena == nullptr) {
+			std::free(header);
+		}
+	}
+	
+	/**@brief Resizes memory allocated by @ref arena_malloc, as @c std::realloc
+	 *   does.
+	 * @param mem Allocated memory, or @c nullptr to allocate new memory.
+	 * @param size Number of bytes.
+	 * @return Resized memory, or @c nullptr if out of memory (in which case
+	 *   @c mem is left as it was).*/
+	inline void *arena_realloc(void *const mem, const size_t size) noexcept {
+		if (mem == nullptr) {
+			return arena_malloc(size);
+		}
+		arena_block_header *header = static_cast<arena_block_header *>(mem)
+			- 1;
+		if (size <= header->size) {
+			return mem;
+		}
+		void *resized = arena_malloc(size);
+		if (resized != nullptr) {
+			std::memcpy(resized, mem, header->size);
+			arena_free(mem);
+		}
+		return resized;
+	}
+	
+	/**@brief Lemon-generated parser allocated from a @ref parse_arena, which
+	 *   is made current for the calling thread for the session's lifetime.
+	 * @details Tokens and AST nodes allocated during the session from
+	 *   <tt>parse_arena::current()</tt> thus share the parser's arena. The
+	 *   previously current arena is restored when the session ends.
+	 * @code{.cpp}
+	 * largemelon::parse_arena arena;
+	 * {
+	 *   largemelon::lemon_parser_session session(arena, ParseAlloc,
+	 *     ParseFree);
+	 *   scan_and_parse(ctx, session.get(), input);
+	 * }
+	 * arena.release();
+	 * @endcode
+	 * @warning A session must end on the thread it began on.*/
+	class lemon_parser_session {
+		/**@brief Arena current before this session began.*/
+		parse_arena *prev_arena_;
+		/**@brief <tt>ParseFree()</tt>-like function.*/
+		lemon_parsefree_func_type parsefree_;
+		/**@brief Parser, or @c nullptr if it couldn't be allocated.*/
+		void *pparser_;
+	public:
+		/**@brief Constructor.
+		 * @param arena Arena to allocate the parser from.
+		 * @param parsealloc <tt>ParseAlloc()</tt>-like function.
+		 * @param parsefree <tt>ParseFree()</tt>-like function.*/
+		lemon_parser_session(parse_arena& arena,
+			const lemon_parsealloc_func_type& parsealloc,
+			lemon_parsefree_func_type parsefree)
+			: prev_arena_(parse_arena::current()),
+			parsefree_(std::move(parsefree)), pparser_(nullptr) {
+			parse_arena::current() = &arena;
+			pparser_ = parsealloc(arena_malloc);
+		}
+		lemon_parser_session(const lemon_parser_session&) = delete;
+		lemon_parser_session& operator=(const lemon_parser_session&)
+			= delete;
+		/**@brief Destructor.*/
+		~lemon_parser_session() {
+			if (pparser_ != nullptr) {
+				parsefree_(pparser_, arena_free);
+			}
+			parse_arena::current() = prev_arena_;
+		}
+		/**@brief Parser, or @c nullptr if the arena was out of memory.*/
+		void *get() const { return pparser_; }
+	};
+	
+	/**@brief Next-expected token IDs of each state of a Lemon-generated
+	 *   parser, each computed in one pass over all terminals the first time
+	 *   it's asked for and then cached, since Lemon's tables don't change.
+	 * @tparam GrammarKey Address of the grammar's own
+	 *   @c yy_find_shift_action, which keeps the caches of different grammars
+	 *   apart. (Every grammar names its parser type @c yyParser, whatever its
+	 *   @c %name, but @c yy_find_shift_action is @c static in the generated
+	 *   parser and so is a different function for each grammar.)
+	 * @tparam NTokens Number of terminals, including end of input (@c 0),
+	 *   which is @c YYNTOKEN.
+	 * @tparam NStates Number of parser states, which is @c YYNSTATE.
+	 * @note Use @ref LARGEMELON_EXPECTED_TOKEN_IDS_NEWER or
+	 *   @ref LARGEMELON_EXPECTED_TOKEN_IDS_OLDER from within the grammar,
+	 *   rather than this class directly. Sets are safe to query from several
+	 *   parsers on different threads at once.*/
+	template <auto GrammarKey, size_t NTokens, size_t NStates>
+	class expected_token_cache {
+		/**@brief Whether each state's set has been computed yet.*/
+		static std::once_flag *onces() {
+			static std::once_flag ONCES[NStates];
+			return ONCES;
+		}
+		/**@brief Set of each state.*/
+		static std::bitset<NTokens> *sets() {
+			static std::bitset<NTokens> SETS[NStates];
+			return SETS;
+		}
+	public:
+		/**@brief Next-expected token IDs in a parser state.
+		 * @tparam IsExpectedFunc Data type for @c is_expected.
+		 * @param stateno Parser state (@c yytos->stateno).
+		 * @param is_expected Function returning whether a token ID is
+		 *   expected in @c stateno, such as by calling @c yy_find_shift_action.
+		 *   It's called once for each terminal other than end of input, and
+		 *   only the first time @c stateno is asked for.
+		 * @return Set with bit @e i set if token ID @e i is expected.*/
+		template <typename IsExpectedFunc>
+		static const std::bitset<NTokens>& get(const size_t stateno,
+			IsExpectedFunc is_expected) {
+			assert(stateno < NStates);
+			std::call_once(onces()[stateno], [&]() {
+				std::bitset<NTokens>& set = sets()[stateno];
+				for (size_t i=1; i<NTokens; i++) {
+					set[i] = is_expected(static_cast<int>(i),
+						static_cast<int>(stateno));
+				}
+			});
+			return sets()[stateno];
+		}
+	};
+	
+	
+	
+	/**@brief Sets the matched text and current location in text for a single
+	 *     parsing step.
+	 * @param mtext Matched text, extracted from parsed text.
+	 * @param loc Location of matched text, relative to parsed text.
+	 * @param fpath Path to file being parsed.
+	 * @param ts Pointer to position of first matched character in parsed text.
+	 * @param te Pointer to position just after last matched character in
+	 *     parsed text.
+	 * @param ltrim Number of characters to trim from the front of the parsed
+	 *     text, starting from @c ts.
+	 * @param rtrim Number of characters to trim from the end of the parsed
+	 *     text, starting from @c te.
+	 * 
+	 * The values of @c ltrim and @c rtrim do not affect the resultant value of
+	 * @c loc, because those characters are still being consumed by the parsing
+	 * step.*/
+	inline void set_mtext_and_loc_trimmed(std::string& mtext, text_loc& loc,
+		const std::filesystem::path& fpath, const char *ts, const char *te,
+		const size_t& ltrim, const size_t& rtrim) {
+		LARGEMELON_UNUSED_PARAM(fpath);
+		assert(ts != nullptr);
+		assert(te != nullptr);
+		assert((te - rtrim) - (ts + ltrim) > 0);
+		mtext = toktext(ts + ltrim, te - rtrim);
+#if LARGEMELON_LF_NEWLINES && LARGEMELON_PADDED_INPUT
+		loc = mtext_loc_lf_padded(loc, ts, te);
+#elif LARGEMELON_LF_NEWLINES
+		loc = mtext_loc_lf(loc, ts, te);
+#elif LARGEMELON_PADDED_INPUT
+		loc = mtext_loc_padded(loc, ts, te);
+#else
+		loc = mtext_loc(loc, ts, te);
+#endif
+	}
+	
+	
+	
+	/**@brief Skips a token matched by a single parsing step.
 	 * @param mtext Matched text, extracted from parsed text.
 	 * @param loc Location of matched text, relative to parsed text.
 	 * @param fpath Path to file being parsed.
@@ -567,6 +1807,202 @@ namespace largemelon {
 	
 	
 	
+	/**@brief Executes action code for the change in block indent at the start
+	 *   of a line, passing the whole run of INDENT or DEDENT tokens to the
+	 *   parser.
+	 * @tparam ContextType Same as @ref parse_null_token.
+	 * @param mtext Matched text, extracted from parsed text.
+	 * @param loc Location of matched text, relative to parsed text.
+	 * @param context Parsing context populated during each parsing step.
+	 * @param fpath Path to file being parsed.
+	 * @param parse_func <tt>Parse()</tt>-like function wrapped by this one.
+	 * @param ts Pointer to position of first matched character in parsed
+	 *   text, e.g., of the newline sequence before the line's indent.
+	 * @param te Pointer to position just after last matched character in
+	 *   parsed text, i.e., just after the line's indent.
+	 * @param pparser Pointer to allocated instance of parser.
+	 * @param indent_token_id Value of the INDENT token, as defined in a
+	 *   Lemon-emitted C/C++ header file.
+	 * @param dedent_token_id Value of the DEDENT token, as defined in a
+	 *   Lemon-emitted C/C++ header file.
+	 * @param indent_change Number of block indent levels by which the line
+	 *   differs from the previous line, as set by
+	 *   @ref block_indent_tracker::update. One INDENT token is passed for
+	 *   each level added, or one DEDENT token for each level removed.
+	 * @param verbosity Level of debug output.
+	 * @return Number of tokens passed to the parser.
+	 * 
+	 * @c parse_func is still called once per token, as Lemon's
+	 * <tt>Parse()</tt> takes a single token. Compared with calling
+	 * @ref parse_null_token once per level, the location is computed and the
+	 * verbosity is checked only once, for the whole run. Every token is
+	 * passed as null, so nothing is allocated per token, and the location
+	 * doesn't reach the parser: it's only left in @c loc for the caller. If
+	 * @c indent_change is @c 0, @c mtext and @c loc are still set, but
+	 * nothing is passed to the parser.
+	 * 
+	 * @note The same restrictions -- or lack thereof -- on the usage of
+	 *   @ref parse_token_trimmed() apply to this function with respect to the
+	 *   @c pparser argument.*/
+	template <typename ContextType>
+	inline size_t parse_indent_tokens(std::string& mtext, text_loc& loc,
+		ContextType& context, const std::filesystem::path& fpath,
+		lemon_parse_func_type<ContextType> parse_func, const char *ts,
+		const char *te, void *const pparser, const size_t& indent_token_id,
+		const size_t& dedent_token_id, const int& indent_change,
+		const int& verbosity) {
+		
+		assert(ts != nullptr);
+		assert(te != nullptr);
+		assert(pparser != nullptr);
+		set_mtext_and_loc_trimmed(mtext, loc, fpath, ts, te, 0, 0);
+		const size_t token_id = (indent_change > 0) ? indent_token_id
+			: dedent_token_id;
+		const size_t ntokens = static_cast<size_t>((indent_change > 0)
+			? indent_change : -indent_change);
+		if (verbosity >= 2 && ntokens > 0) {
+			std::cerr << "Passing " << ntokens << " token(s) (id=" << token_id
+				<< ") at " << loc << " to the parser as null" << std::endl;
+		}
+		for (size_t i=0; i<ntokens; i++) {
+			parse_func(pparser, token_id, nullptr, &context);
+		}
+		return ntokens;
+		
+	}
+	
+	
+	
+	/**@brief Tracker of code block indents, as might be used in a language
+	 *   where indentation produces code structure (such as in Python).
+	 * @details The absolute indent of each open block is kept, in increasing
+	 *   order, so that a line with the same indent as the last one, or a
+	 *   larger one, takes constant time, and a line with a smaller indent
+	 *   takes a binary search for the block it returns to.*/
+	class block_indent_tracker {
+		/**@brief Number of columns occupied by the absolute indent of each
+		 *   open block, in increasing order.*/
+		std::vector<size_t> indents_;
+	public:
+		/**@brief Constructor, with no open blocks.*/
+		block_indent_tracker() : indents_() {}
+		/**@brief Constructor from relative block indents, as kept by
+		 *   @ref update_block_indents.
+		 * @param widths Number of columns occupied by each open block's
+		 *   indent, relative to the block before it. None of them can be
+		 *   @c 0.*/
+		explicit block_indent_tracker(const std::vector<size_t>& widths)
+			: indents_(widths.size()) {
+			std::partial_sum(widths.begin(), widths.end(), indents_.begin());
+			assert(std::adjacent_find(indents_.begin(), indents_.end(),
+				std::greater_equal<size_t>()) == indents_.end());
+			assert(indents_.empty() || indents_.front() > 0);
+		}
+		/**@brief Updates the open blocks for the indent of the next line.
+		 * @param indent_change Number of block indent levels by which the
+		 *   line differs from the previous line: @c 1 if it opens a block,
+		 *   minus the number of blocks it closes, or @c 0.
+		 * @param curr_width Number of columns occupied by the line's absolute
+		 *   indent.
+		 * @param verbosity Level of debug verbosity.
+		 * @return @c 0 on success, nonzero if @c curr_width is smaller than
+		 *   the current indent but doesn't match the indent of any open
+		 *   block, in which case nothing is changed.*/
+		int update(int& indent_change, const size_t curr_width,
+			const int verbosity = 0) {
+			const size_t prev_width = indent();
+			if (verbosity >= 2) {
+				std::cout << std::endl
+					<< "block_indent_tracker::update:" << std::endl
+					<< "  previous indents are [ ";
+				for (auto &w: indents_)
+					std::cout << w << " ";
+				std::cout << "]" << std::endl
+					<< "  current indent is " << curr_width << std::endl;
+			}
+			if (curr_width == prev_width) {
+				indent_change = 0;
+				if (verbosity >= 2) {
+					std::cout << "  current indent is same as previous indent"
+						<< std::endl;
+				}
+			}
+			else if (curr_width > prev_width) {
+				indents_.push_back(curr_width);
+				indent_change = 1;
+				if (verbosity >= 2) {
+					std::cout << "  current indent adds block indent of "
+						<< (curr_width - prev_width) << std::endl;
+				}
+			}
+			else {
+				// The line must return to the indent of an open block, or
+				// close them all.
+				auto it = std::lower_bound(indents_.begin(), indents_.end(),
+					curr_width);
+				if (curr_width > 0 && *it != curr_width) {
+					if (verbosity >= 2) {
+						std::cout << "  current indent doesn't align with any "
+							<< "previous indentation levels" << std::endl;
+					}
+					return 1;
+				}
+				if (curr_width > 0) {
+					it++;
+				}
+				indent_change = -static_cast<int>(indents_.end() - it);
+				indents_.erase(it, indents_.end());
+				if (verbosity >= 2) {
+					std::cout << "  current indent reduces " << (-indent_change)
+						<< " level(s)" << std::endl;
+				}
+			}
+			assert(indent() == curr_width);
+			return 0;
+		}
+		/**@brief Measures a line's indent and updates the open blocks for it.
+		 * @tparam IndentPolicy Same as @ref measure_indent.
+		 * @param indent_change Same as @ref update.
+		 * @param size Number of characters in the line's indent, which the
+		 *   caller might skip.
+		 * @param ls Pointer to first character of line.
+		 * @param te Pointer to just after last character of text.
+		 * @param verbosity Level of debug verbosity.
+		 * @return @c 0 on success, nonzero if @c IndentPolicy rejects the
+		 *   indent or @ref update fails, in which case nothing is changed.
+		 * @note The indent is measured with @ref measure_indent_padded if
+		 *   @ref LARGEMELON_PADDED_INPUT is set.*/
+		template <typename IndentPolicy>
+		int update_line(int& indent_change, size_t& size, const char *ls,
+			const char *te, const int verbosity = 0) {
+			size_t width;
+#if LARGEMELON_PADDED_INPUT
+			int rc = measure_indent_padded<IndentPolicy>(width, size, ls, te);
+#else
+			int rc = measure_indent<IndentPolicy>(width, size, ls, te);
+#endif
+			if (rc != 0) {
+				if (verbosity >= 2) {
+					std::cout << std::endl
+						<< "block_indent_tracker::update_line:" << std::endl
+						<< "  current indent is rejected by indent policy"
+						<< std::endl;
+				}
+				return rc;
+			}
+			return update(indent_change, width, verbosity);
+		}
+		/**@brief Number of open blocks.*/
+		size_t depth() const { return indents_.size(); }
+		/**@brief Number of columns occupied by the current absolute indent,
+		 *   which is @c 0 if no blocks are open.*/
+		size_t indent() const {
+			return indents_.empty() ? 0 : indents_.back();
+		}
+		/**@brief Absolute indent of each open block, in increasing order.*/
+		const std::vector<size_t>& indents() const { return indents_; }
+	};
+	
 	/**@brief Updates a tracker of code block indents, as might be used in a
 	 *   language where indentation produces code structure (such as in
 	 *   Python).
@@ -582,93 +2018,232 @@ namespace largemelon {
 	 * Each element of @c prev_widths represents the number of columns occupied
 	 * by each prior code block's indent.
 	 * 
+	 * @note This is kept for compatibility. It converts @c prev_widths to a
+	 *   @ref block_indent_tracker on every call, which takes time in
+	 *   proportion to the number of open blocks; keep a
+	 *   @ref block_indent_tracker between lines instead.
 	 * @warning This function's behavior may be undefined if there are elements
 	 *   of @c prev_widths with value @c 0.*/
 	inline int update_block_indents(int& indent_change,
 		std::vector<size_t>& prev_widths, const size_t curr_width,
 		const int verbosity = 0) {
-		size_t total_prev_width;
-		total_prev_width = std::accumulate(prev_widths.begin(),
-			prev_widths.end(), 0);
-		
-		if (verbosity >= 2) {
-			std::cout << std::endl
-				<< "update_block_indents:" << std::endl
-				<< "  previous indents are [ ";
-			for (auto &w: prev_widths)
-				std::cout << w << " ";
-			std::cout << "] (" << total_prev_width << " total)" << std::endl
-				<< "  current indent is " << curr_width << std::endl;
+		block_indent_tracker tracker(prev_widths);
+		const size_t total_prev_width = tracker.indent();
+		int rc = tracker.update(indent_change, curr_width, verbosity);
+		if (rc != 0) {
+			return rc;
 		}
-		
-		if (curr_width == 0) {
-			if (verbosity >= 2) {
-				std::cout << "  current indent reduces " << prev_widths.size()
-					<< " level(s)" << std::endl;
+		if (indent_change > 0) {
+			prev_widths.push_back(curr_width - total_prev_width);
+		}
+		else {
+			prev_widths.resize(prev_widths.size() + indent_change);
+		}
+		return 0;
+	}
+	
+	
+	
+	/**@brief Sequential container that keeps up to @c N elements inline,
+	 *   moving them to the heap only when it grows past that.
+	 * @tparam T Data type for elements, which must be trivially copyable
+	 *   (e.g., pointers), so that elements can be moved with @c std::memcpy.
+	 * @tparam N Number of elements kept inline.
+	 * @details This has the parts of the @c std::vector interface needed for
+	 *   child AST nodes (see @ref ast_base_type::childs). Iterators are
+	 *   pointers, and are invalidated as for @c std::vector.*/
+	template <typename T, size_t N>
+	class small_vector {
+		static_assert(std::is_trivially_copyable<T>::value, "expected "
+			"elements of small_vector to be trivially copyable");
+	public:
+		typedef T value_type;
+		typedef T* iterator;
+		typedef const T* const_iterator;
+	private:
+		/**@brief Elements, either @ref inline_ or on the heap.*/
+		T *data_;
+		/**@brief Number of elements.*/
+		size_t size_;
+		/**@brief Number of elements that fit in @ref data_.*/
+		size_t capacity_;
+		/**@brief Storage for up to @c N elements.*/
+		T inline_[N > 0 ? N : 1];
+		/**@brief Whether the elements are on the heap.*/
+		bool on_heap() const { return data_ != inline_; }
+		/**@brief Moves the elements to new heap storage.
+		 * @param capacity Number of elements the new storage fits.*/
+		void grow(const size_t capacity) {
+			assert(capacity > capacity_);
+			T *heap = static_cast<T *>(std::malloc(capacity * sizeof(T)));
+			if (heap == nullptr) {
+				throw std::bad_alloc();
+			}
+			if (size_ > 0) {
+				std::memcpy(heap, data_, size_ * sizeof(T));
 			}
-			indent_change = -prev_widths.size();
-			prev_widths.clear();
+			if (on_heap()) {
+				std::free(data_);
+			}
+			data_ = heap;
+			capacity_ = capacity;
 		}
-		
-		// If the current total indent is greater than the previous absolute
-		// indent, then add a new relative indent to make up the difference.
-		else if (curr_width > total_prev_width) {
-			prev_widths.push_back(curr_width - total_prev_width);
-			indent_change = 1;
-			if (verbosity >= 2) {
-				std::cout << "  current indent adds block indent of "
-					<< prev_widths.back() << std::endl;
+	public:
+		/**@brief Constructor, with no elements.*/
+		small_vector() : data_(inline_), size_(0),
+			capacity_(N > 0 ? N : 1) {}
+		/**@brief Constructor from a range of elements.
+		 * @param first Iterator to first element.
+		 * @param last Iterator to position just after last element.*/
+		template <typename IteratorType>
+		small_vector(IteratorType first, IteratorType last) : small_vector() {
+			insert(end(), first, last);
+		}
+		/**@brief Copy constructor.*/
+		small_vector(const small_vector& other) : small_vector() {
+			insert(end(), other.begin(), other.end());
+		}
+		/**@brief Move constructor. @c other is left empty.*/
+		small_vector(small_vector&& other) noexcept : small_vector() {
+			*this = std::move(other);
+		}
+		/**@brief Copy assignment.*/
+		small_vector& operator=(const small_vector& other) {
+			if (this != &other) {
+				clear();
+				insert(end(), other.begin(), other.end());
 			}
+			return *this;
 		}
-		
-		// If the current total indent is less than the previous absolute
-		// indent. It must then match the sum of a sub-range of the relative
-		// indents, starting from the first relative indent.
-		else if (curr_width < total_prev_width) {
-			assert(0 < curr_width);
-			auto rit = prev_widths.rbegin();
-			for (; rit!=prev_widths.rend(); rit++) {
-				total_prev_width -= (*rit);
-				assert(total_prev_width
-					== (size_t)std::accumulate(rit+1, prev_widths.rend(), 0));
-				if (total_prev_width == curr_width)
-					break;
-				else if (total_prev_width < curr_width) {
-					if (verbosity >= 2) {
-						std::cout << "  current indent doesn't align with any "
-							<< "previous indentation levels" << std::endl;
-					}
-					return 1;
+		/**@brief Move assignment. @c other is left empty.*/
+		small_vector& operator=(small_vector&& other) noexcept {
+			if (this == &other) {
+				return *this;
+			}
+			if (on_heap()) {
+				std::free(data_);
+			}
+			if (other.on_heap()) {
+				data_ = other.data_;
+				capacity_ = other.capacity_;
+			}
+			else {
+				data_ = inline_;
+				capacity_ = (N > 0 ? N : 1);
+				if (other.size_ > 0) {
+					std::memcpy(inline_, other.inline_, other.size_ * sizeof(T));
 				}
 			}
-			indent_change = -std::distance(prev_widths.rbegin(), rit + 1);
-			prev_widths.resize(prev_widths.size() + indent_change);
-			if (verbosity >= 2) {
-				std::cout << "  current indent reduces " << (-indent_change)
-					<< " level(s) to [ ";
-				for (auto &w: prev_widths)
-					std::cout << w << " ";
-				std::cout << "]" << std::endl;
+			size_ = other.size_;
+			other.data_ = other.inline_;
+			other.size_ = 0;
+			other.capacity_ = (N > 0 ? N : 1);
+			return *this;
+		}
+		/**@brief Destructor.*/
+		~small_vector() {
+			if (on_heap()) {
+				std::free(data_);
 			}
 		}
-		
-		// Otherwise, the current total indent is equal to the previous
-		// absolute indent, so do nothing.
-		else {
-			assert(curr_width == total_prev_width);
-			indent_change = 0;
-			if (verbosity >= 2) {
-				std::cout << "  current indent is same as previous indent"
-					<< std::endl;
+		iterator begin() { return data_; }
+		iterator end() { return data_ + size_; }
+		const_iterator begin() const { return data_; }
+		const_iterator end() const { return data_ + size_; }
+		T *data() { return data_; }
+		const T *data() const { return data_; }
+		size_t size() const { return size_; }
+		bool empty() const { return size_ == 0; }
+		size_t capacity() const { return capacity_; }
+		/**@brief Whether the elements are kept inline, without a heap
+		 *   allocation.*/
+		bool is_inline() const { return ! on_heap(); }
+		T& operator[](const size_t i) { assert(i < size_); return data_[i]; }
+		const T& operator[](const size_t i) const {
+			assert(i < size_);
+			return data_[i];
+		}
+		T& front() { assert(size_ > 0); return data_[0]; }
+		const T& front() const { assert(size_ > 0); return data_[0]; }
+		T& back() { assert(size_ > 0); return data_[size_ - 1]; }
+		const T& back() const { assert(size_ > 0); return data_[size_ - 1]; }
+		/**@brief Makes room for at least @c capacity elements.*/
+		void reserve(const size_t capacity) {
+			if (capacity > capacity_) {
+				grow(capacity);
 			}
 		}
-		
-		assert((size_t)std::accumulate(prev_widths.begin(), prev_widths.end(),
-			0) == curr_width);
-		return 0;
-	}
-	
+		void push_back(const T& value) {
+			if (size_ == capacity_) {
+				T copy = value;
+				grow(2 * capacity_);
+				data_[size_++] = copy;
+				return;
+			}
+			data_[size_++] = value;
+		}
+		void pop_back() { assert(size_ > 0); size_--; }
+		/**@brief Removes all elements, keeping the storage.*/
+		void clear() { size_ = 0; }
+		/**@brief Removes a range of elements.
+		 * @return Iterator to the element after those removed.*/
+		iterator erase(const_iterator first, const_iterator last) {
+			assert(begin() <= first && first <= last && last <= end());
+			iterator i = data_ + (first - data_);
+			size_t n = static_cast<size_t>(last - first);
+			if (n > 0) {
+				std::memmove(i, last, (end() - last) * sizeof(T));
+				size_ -= n;
+			}
+			return i;
+		}
+		/**@brief Removes an element.
+		 * @return Iterator to the element after the one removed.*/
+		iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+		/**@brief Inserts a range of elements.
+		 * @param pos Iterator to the element to insert before.
+		 * @param first Iterator to first element.
+		 * @param last Iterator to position just after last element.
+		 * @return Iterator to the first element inserted.
+		 * @warning The inserted range must not be within this container.*/
+		template <typename IteratorType>
+		iterator insert(const_iterator pos, IteratorType first,
+			IteratorType last) {
+			assert(begin() <= pos && pos <= end());
+			size_t off = static_cast<size_t>(pos - data_);
+			size_t n = static_cast<size_t>(std::distance(first, last));
+			if (size_ + n > capacity_) {
+				grow(std::max(size_ + n, 2 * capacity_));
+			}
+			iterator i = data_ + off;
+			std::memmove(i + n, i, (size_ - off) * sizeof(T));
+			std::copy(first, last, i);
+			size_ += n;
+			return i;
+		}
+		bool operator==(const small_vector& other) const {
+			return std::equal(begin(), end(), other.begin(), other.end());
+		}
+		bool operator!=(const small_vector& other) const {
+			return !(*this == other);
+		}
+	};
 	
+	/**@brief Trait giving the number of child nodes kept inline in each AST
+	 *   node for a given enumerated AST node type, before they're moved to
+	 *   the heap.
+	 * @tparam AstEnumType Enumerated AST node type.
+	 * 
+	 * The default suits grammars whose nodes mostly have up to four child
+	 * nodes. To change it for an application with an enumerated AST node
+	 * type @c nt, specialize this before any AST node class is defined:
+	 * @code{.cpp}
+	 * template <>
+	 * struct largemelon::ast_child_capacity<nt>
+	 *   : std::integral_constant<size_t, 2> {};
+	 * @endcode*/
+	template <typename AstEnumType>
+	struct ast_child_capacity : public std::integral_constant<size_t, 4> {};
 	
 	template <typename AstEnumType>
 	class ast_base_type;
@@ -684,8 +2259,12 @@ namespace largemelon {
 			"integral or enumeration type");
 	protected:
 		/**@brief Data type for a sequential collection of pointers to child
-		 *   AST nodes, in their original order of addition to this node.*/
-		typedef std::vector<ast_base_type<AstEnumType>*> child_coll_type;
+		 *   AST nodes, in their original order of addition to this node.
+		 * @details Up to <tt>ast_child_capacity<AstEnumType>::value</tt>
+		 *   pointers are kept within the node itself, so that most nodes
+		 *   need no separate allocation for them.*/
+		typedef small_vector<ast_base_type<AstEnumType>*,
+			ast_child_capacity<AstEnumType>::value> child_coll_type;
 		/**@brief Pointers to child AST nodes, in their original order of
 		 *   addition to this node.*/
 		child_coll_type childs_;
@@ -694,14 +2273,18 @@ namespace largemelon {
 		ast_base_type<AstEnumType>* parent_;
 		/**@brief Location in parsed source of text represented by this node.*/
 		text_loc loc_;
+		/**@brief Enumerated value associated with this node's type.*/
+		AstEnumType type_;
 	protected:
 		/**@brief Constructor.
 		 * @param loc Location of original text in parsed source.
+		 * @param type Enumerated value associated with this node's type, as
+		 *   set by @ref ast_typed_base_type.
 		 * @details This node is set as the root node of its AST and with no
 		 *   child nodes. This node's parent node is not set until this node is
 		 *   set as a child node of another node.*/
-		ast_base_type(const text_loc& loc) : childs_(), parent_(this),
-			loc_(loc) {
+		ast_base_type(const text_loc& loc, const AstEnumType type)
+			: childs_(), parent_(this), loc_(loc), type_(type) {
 			assert(parent_ != nullptr);
 		}
 		/**@brief Assigns an existing AST node as a child of this node, and
@@ -710,19 +2293,74 @@ namespace largemelon {
 		 * @details The parent node of @c child becomes this node.
 		 * @details If @c child is @c nullptr, then nothing happens.
 		 * @details If @c child is already in this node's child nodes, then
-		 *   this class method does nothing.*/
+		 *   this class method does nothing. That is known from @c child's
+		 *   parent node being this node, so adding a child node takes
+		 *   constant time.*/
 		void add_child(ast_base_type<AstEnumType>* const child) {
-			if (child == nullptr) {
-				return;
-			}
-			size_t n = std::count(childs_.begin(), childs_.end(), child);
-			assert(n <= 1);
-			if (n > 0) {
+			if (child == nullptr || child->parent_ == this) {
 				return;
 			}
 			child->parent_ = this;
 			childs_.push_back(child);
 		}
+		/**@brief Assigns a range of existing AST nodes as children of this
+		 *   node, as with @ref add_child, making room for all of them at
+		 *   once.
+		 * @tparam IteratorType Data type for iterator over pointers to AST
+		 *   nodes.
+		 * @param first Iterator to first node.
+		 * @param last Iterator to position just after last node.
+		 * @details Null and duplicate nodes are skipped, as with
+		 *   @ref add_child.*/
+		template <typename IteratorType>
+		void add_child_range(IteratorType first, IteratorType last) {
+			if constexpr (std::is_base_of<std::forward_iterator_tag,
+				typename std::iterator_traits<IteratorType>::iterator_category
+				>::value) {
+				childs_.reserve(childs_.size() + static_cast<size_t>(
+					std::distance(first, last)));
+			}
+			for (; first!=last; ++first) {
+				add_child(*first);
+			}
+		}
+		/**@brief Moves all of another node's child nodes to the end of this
+		 *   node's child nodes, and sets this node as their parent, as when
+		 *   subtrees parsed separately are grafted under one root (see
+		 *   @ref parse_regions).
+		 * @param donor Node giving up its child nodes, which is left with
+		 *   none.
+		 * @details As with @ref add_child, ownership of the child nodes is
+		 *   left to the derived classes.*/
+		void graft_childs(ast_base_type<AstEnumType>& donor) {
+			assert(&donor != this);
+			add_child_range(donor.childs_.begin(), donor.childs_.end());
+			donor.childs_.clear();
+		}
+		/**@brief Replaces a run of this node's child nodes with all of another
+		 *   node's child nodes, as when the text of a subtree is parsed again
+		 *   after an edit (see @ref smallest_enclosing_node).
+		 * @param pos Index of first child node replaced.
+		 * @param count Number of child nodes replaced.
+		 * @param donor Node giving up its child nodes, which is left with
+		 *   none.
+		 * @details The replaced child nodes become root nodes, so that the
+		 *   derived classes that own them can delete them.*/
+		void splice_childs(const size_t pos, const size_t count,
+			ast_base_type<AstEnumType>& donor) {
+			assert(&donor != this);
+			assert(pos + count <= childs_.size());
+			for (size_t i=pos; i<pos+count; i++) {
+				childs_[i]->parent_ = childs_[i];
+			}
+			for (ast_base_type<AstEnumType>* const child: donor.childs_) {
+				child->parent_ = this;
+			}
+			auto i = childs_.erase(childs_.begin() + pos,
+				childs_.begin() + pos + count);
+			childs_.insert(i, donor.childs_.begin(), donor.childs_.end());
+			donor.childs_.clear();
+		}
 		/**@brief Tail case for @ref add_childs. Does nothing.*/
 		void add_childs() {}
 		/**@brief Assigns multiple AST nodes as children of this node, and sets
@@ -740,14 +2378,20 @@ namespace largemelon {
 			add_childs(childs...);
 		}
 	public:
+		/**@brief Destructor.
+		 * @details This is virtual so that AST nodes can be owned, and
+		 *   deleted, through pointers to @ref ast_base_type. Child nodes are
+		 *   not deleted; that is left to the derived classes that own them.*/
+		virtual ~ast_base_type() = default;
 		/**@brief Enumerated value associated with AST nodes of this type.
-		 * @details This is defined by every class derived from
-		 *   @ref ast_base_type. Each derived type of AST node has an
+		 * @details This is set by every class derived from
+		 *   @ref ast_typed_base_type. Each derived type of AST node has an
 		 *   associated enumerated value. This way, the AST node can be passed
-		 *   around as an @ref ast_base_type pointer and then be
-		 *   <tt>dynamic_cast</tt>-ed back to the class type associated with
-		 *   its enumerated type.*/
-		virtual constexpr AstEnumType type() const = 0;
+		 *   around as an @ref ast_base_type pointer and then be cast back
+		 *   with @ref node_cast to the class type associated with its
+		 *   enumerated type. It is kept in the node, so reading it isn't a
+		 *   virtual call.*/
+		AstEnumType type() const { return type_; }
 		/**@brief Parent AST node.
 		 * @note If <tt>this == this->parent()</tt>, then this is the root
 		 *   node of its AST.*/
@@ -780,6 +2424,21 @@ namespace largemelon {
 		void set_loc(const text_loc& loc) {
 			this->loc_ = loc;
 		}
+		/**@brief Shifts the text locations of this node and its descendants
+		 *   past an edit of the parsed source (see @ref shift_text_loc).
+		 * @param delta Shift in locations after the edit.
+		 * @details Only nodes ending after the replaced text are visited,
+		 *   since child nodes lie within their parent node's location. A node
+		 *   with no location (@ref EMPTY_TEXT_LOC) is taken to span all of its
+		 *   child nodes.*/
+		void shift_locs(const text_loc_delta& delta) {
+			if (loc_ != EMPTY_TEXT_LOC && ! shift_text_loc(loc_, delta)) {
+				return;
+			}
+			for (ast_base_type<AstEnumType>* const child: childs_) {
+				child->shift_locs(delta);
+			}
+		}
 	};
 	
 	
@@ -849,6 +2508,44 @@ namespace largemelon {
 	
 	
 	
+	/**@brief Smallest subtree of an AST that spans a text location and can be
+	 *   parsed again on its own, as after an edit of the text.
+	 * @tparam AstEnumType Data type for enumerated AST node types.
+	 * @param root Root node of AST, which is taken to span all of the text.
+	 * @param loc Location of changed text, as of the changed tokens after
+	 *   @ref incremental_lexer::relex, with the AST already shifted past the
+	 *   edit (see @ref ast_base_type::shift_locs).
+	 * @param reparsable Function telling whether the text of a node can be
+	 *   parsed again on its own, such as for nodes of a type that a Lemon
+	 *   grammar's start symbol derives.
+	 * @return Deepest node spanning @c loc for which @c reparsable returns
+	 *   @c true, or @c root if there is none.*/
+	template <typename AstEnumType>
+	inline ast_base_type<AstEnumType>* smallest_enclosing_node(
+		ast_base_type<AstEnumType>* const root, const text_loc& loc,
+		const std::function<bool(const ast_base_type<AstEnumType>&)>&
+			reparsable) {
+		assert(root != nullptr);
+		ast_base_type<AstEnumType>* best = root;
+		ast_base_type<AstEnumType>* n = root;
+		while (n != nullptr) {
+			ast_base_type<AstEnumType>* next = nullptr;
+			for (ast_base_type<AstEnumType>* const child: n->childs()) {
+				if (span_loc_contains(child->loc(), loc)) {
+					next = child;
+					break;
+				}
+			}
+			if (next != nullptr && reparsable(*next)) {
+				best = next;
+			}
+			n = next;
+		}
+		return best;
+	}
+	
+	
+	
 	/**@brief Extends @c ast_base_type to associate it with an enumerated AST
 	 *   node type and implement the @ref ast_base_type::type method.
 	 * @tparam AstEnumType Data type for enumerated AST node type.
@@ -861,12 +2558,51 @@ namespace largemelon {
 		/**@brief Constructor.
 		 * @param loc Location of original text in parsed source.*/
 		ast_typed_base_type(const text_loc& loc)
-			: ast_base_type<AstEnumType>(loc) {}
+			: ast_base_type<AstEnumType>(loc, N) {}
 	public:
-		/**@brief Enumerated AST node type.*/
-		constexpr AstEnumType type() const override { return N; }
+		/**@brief Enumerated AST node type, as returned by
+		 *   @ref ast_base_type::type.*/
+		static constexpr AstEnumType TYPE = N;
 	};
 	
+	/**@brief Casts an AST node to the class type associated with its
+	 *   enumerated type, checking the type first.
+	 * @tparam NodeType Class type, derived from @ref ast_typed_base_type.
+	 * @tparam AstEnumType Data type for enumerated AST node types.
+	 * @param n AST node, or @c nullptr.
+	 * @return @c n as a @c NodeType, or @c nullptr if @c n is @c nullptr or
+	 *   of another type.
+	 * @details This compares <tt>n->type()</tt> with <tt>NodeType::TYPE</tt>
+	 *   and then uses @c static_cast, so it costs no more than a load and a
+	 *   comparison, unlike @c dynamic_cast.
+	 * @warning Each enumerated value must be associated with exactly one
+	 *   class type, as is meant by @ref ast_typed_base_type; a class derived
+	 *   from another node class shares its enumerated value, so a node of the
+	 *   base class would pass the check.*/
+	template <typename NodeType, typename AstEnumType>
+	inline NodeType* node_cast(ast_base_type<AstEnumType>* const n) {
+		static_assert(std::is_base_of<ast_typed_base_type<AstEnumType,
+			NodeType::TYPE>, NodeType>::value, "expected NodeType to be "
+			"derived from ast_typed_base_type<AstEnumType, NodeType::TYPE>");
+		if (n == nullptr || n->type() != NodeType::TYPE) {
+			return nullptr;
+		}
+		return static_cast<NodeType*>(n);
+	}
+	
+	/**@brief Same as @ref node_cast, for a @c const AST node.*/
+	template <typename NodeType, typename AstEnumType>
+	inline const NodeType* node_cast(
+		const ast_base_type<AstEnumType>* const n) {
+		static_assert(std::is_base_of<ast_typed_base_type<AstEnumType,
+			NodeType::TYPE>, NodeType>::value, "expected NodeType to be "
+			"derived from ast_typed_base_type<AstEnumType, NodeType::TYPE>");
+		if (n == nullptr || n->type() != NodeType::TYPE) {
+			return nullptr;
+		}
+		return static_cast<const NodeType*>(n);
+	}
+	
 	
 	
 	static_assert(std::is_base_of< ast_base_type<int>,
@@ -923,37 +2659,866 @@ namespace largemelon {
 		&& (!std::is_same<ast_base_type<AstEnumType>, ClassType>::value)
 	> {};
 	
+	/**@brief Set of handlers for @ref visit, one per class type of AST node,
+	 *   combined into a single overloaded function object.
+	 * @tparam HandlerTypes Data types for handlers, usually lambdas.
+	 * @code{.cpp}
+	 * largemelon::visit(*node, largemelon::overloaded{
+	 *   [](ast_bool_literal& b) { return b.value() ? 1 : 0; },
+	 *   [](ast_data_decl& d) { return 2; },
+	 *   [](ast_base& n) { return 0; },
+	 * });
+	 * @endcode*/
+	template <typename... HandlerTypes>
+	struct overloaded : HandlerTypes... {
+		using HandlerTypes::operator()...;
+	};
 	
+	template <typename... HandlerTypes>
+	overloaded(HandlerTypes...) -> overloaded<HandlerTypes...>;
 	
-	/**@brief Collection of registers managed by a Ragel-generated scanner.
-	 * @details To use this in the same C++ source file as a Ragel machine
-	 *   instantiation:
-	 * @code{.cpp}
-	 * largemelon::ragel_scanner_pers_type rp;
-	 * 
-	 * %% access rp.;
-	 * %% variable p   rp.p;
-	 * %% variable pe  rp.pe;
-	 * %% variable eof rp.eof;
-	 * %% write data;
-	 * 
-	 * // set up parser...
-	 * 
-	 * %% write init;
-	 * %% write exec;
-	 * 
-	 * // ...
-	 * @endcode
-	 * See the Ragel user manual for details.*/
-	struct ragel_scanner_pers_type {
-		/**@brief Pointer to first input character.*/
-		const char *p;
-		/**@brief Pointer to just after last input character.*/
-		const char *pe;
-		/**@brief Pointer to end of opened file, if applicable.*/
-		const char *eof;
-		/**@brief Register for current internal parser state.*/
-		int cs;
+	/**@brief Class type of AST node handled by a handler passed to
+	 *   @ref visit, taken from the parameter of its call operator.
+	 * @tparam HandlerType Data type for handler.
+	 * @details @c node_type is @c void for a handler whose call operator is a
+	 *   template (e.g., a generic lambda), which can only be a fallback.*/
+	template <typename HandlerType, typename = void>
+	struct visit_handler_traits {
+		typedef void node_type;
+	};
+	
+	template <typename HandlerType>
+	struct visit_handler_traits<HandlerType,
+		std::void_t<decltype(&HandlerType::operator())> >
+		: visit_handler_traits<decltype(&HandlerType::operator())> {};
+	
+	template <typename ClassType, typename ResultType, typename ParamType>
+	struct visit_handler_traits<ResultType (ClassType::*)(ParamType) const> {
+		typedef typename std::remove_cv<
+			typename std::remove_reference<ParamType>::type>::type node_type;
+	};
+	
+	template <typename ClassType, typename ResultType, typename ParamType>
+	struct visit_handler_traits<ResultType (ClassType::*)(ParamType)> {
+		typedef typename std::remove_cv<
+			typename std::remove_reference<ParamType>::type>::type node_type;
+	};
+	
+	/**@brief Whether a handler passed to @ref visit handles a single class
+	 *   type of AST node, rather than being a fallback.
+	 * @tparam AstEnumType Data type for enumerated AST node types.
+	 * @tparam HandlerType Data type for handler.*/
+	template <typename AstEnumType, typename HandlerType>
+	struct is_typed_visit_handler : public std::integral_constant<bool,
+		is_ast_node_subclass_type<AstEnumType,
+			typename visit_handler_traits<HandlerType>::node_type>::value
+	> {};
+	
+	/**@brief Parameter type with which a handler passed to @ref visit is
+	 *   called.
+	 * @tparam BaseType @ref ast_base_type, possibly @c const.
+	 * @tparam HandlerType Data type for handler.*/
+	template <typename BaseType, typename HandlerType>
+	struct visit_param {
+		typedef typename visit_handler_traits<HandlerType>::node_type
+			node_type;
+		typedef typename std::conditional<
+			is_typed_visit_handler<decltype(std::declval<
+				typename std::remove_const<BaseType>::type&>().type()),
+				HandlerType>::value,
+			typename std::conditional<std::is_const<BaseType>::value,
+				const node_type, node_type>::type,
+			BaseType>::type type;
+	};
+	
+	/**@brief Result type of @ref visit, which is that of its first handler.
+	 * @tparam BaseType @ref ast_base_type, possibly @c const.
+	 * @tparam VisitorType @ref overloaded, possibly @c const.
+	 * @details This has no @c type member if the first handler can't be
+	 *   called for @c BaseType, as for a handler taking a non-@c const
+	 *   reference when the node is @c const, or a @c mutable handler when
+	 *   the handlers are @c const.*/
+	template <typename BaseType, typename VisitorType>
+	struct visit_result {};
+	
+	template <typename BaseType, typename HandlerType,
+		typename... HandlerTypes>
+	struct visit_result<BaseType, overloaded<HandlerType, HandlerTypes...> >
+		: public std::invoke_result<HandlerType&,
+		typename visit_param<BaseType, HandlerType>::type&> {};
+	
+	template <typename BaseType, typename HandlerType,
+		typename... HandlerTypes>
+	struct visit_result<BaseType,
+		const overloaded<HandlerType, HandlerTypes...> >
+		: public std::invoke_result<const HandlerType&,
+		typename visit_param<BaseType, HandlerType>::type&> {};
+	
+	/**@brief Calls a handler passed to @ref visit for an AST node known to be
+	 *   of the class type it handles.*/
+	template <typename ResultType, typename HandlerType, typename BaseType,
+		typename VisitorType>
+	inline ResultType visit_handler_call(BaseType& n, VisitorType& visitor) {
+		typedef typename std::conditional<std::is_const<VisitorType>::value,
+			const HandlerType, HandlerType>::type handler_type;
+		return static_cast<handler_type&>(visitor)(static_cast<
+			typename visit_param<BaseType, HandlerType>::type&>(n));
+	}
+	
+	/**@brief Calls the fallback handler passed to @ref visit, if there is
+	 *   one, for an AST node of a type no other handler handles.*/
+	template <typename ResultType, typename BaseType, typename VisitorType>
+	inline ResultType visit_fallback_call(BaseType& n, VisitorType& visitor) {
+		if constexpr (std::is_invocable<VisitorType&, BaseType&>::value) {
+			return visitor(n);
+		}
+		else if constexpr (! std::is_void<ResultType>::value) {
+			return ResultType();
+		}
+	}
+	
+	/**@brief Calls the handler for an AST node's type, or the fallback, by
+	 *   comparing the node's type with that of each handler in turn.
+	 * @internal The comparisons are all inlined into one chain, along with
+	 *   the handlers.*/
+	template <typename ResultType, typename BaseType, typename VisitorType>
+	inline ResultType visit_chain(BaseType& n, VisitorType& visitor) {
+		return visit_fallback_call<ResultType>(n, visitor);
+	}
+	
+	/**@brief Same as the other @c visit_chain, for the next handler.*/
+	template <typename ResultType, typename HandlerType,
+		typename... HandlerTypes, typename BaseType, typename VisitorType>
+	inline ResultType visit_chain(BaseType& n, VisitorType& visitor) {
+		typedef typename std::remove_const<BaseType>::type base_type;
+		typedef decltype(std::declval<base_type&>().type()) enum_type;
+		if constexpr (is_typed_visit_handler<enum_type, HandlerType>::value) {
+			if (n.type()
+				== visit_handler_traits<HandlerType>::node_type::TYPE) {
+				return visit_handler_call<ResultType, HandlerType>(n, visitor);
+			}
+		}
+		return visit_chain<ResultType, HandlerTypes...>(n, visitor);
+	}
+	
+	/**@brief Jump table for @ref visit, from each enumerated type between the
+	 *   smallest and largest handled to the function calling its handler (or
+	 *   the fallback), built at compile time.
+	 * @tparam ResultType Result type of @ref visit.
+	 * @tparam BaseType @ref ast_base_type, possibly @c const.
+	 * @tparam VisitorType Data type for all handlers together, possibly
+	 *   @c const.
+	 * @tparam HandlerTypes Data types for handlers.*/
+	template <typename ResultType, typename BaseType, typename VisitorType,
+		typename... HandlerTypes>
+	struct visit_table {
+		/**@brief Data type for enumerated AST node types.*/
+		typedef decltype(std::declval<
+			typename std::remove_const<BaseType>::type&>().type()) enum_type;
+		/**@brief Data type for an entry of the table.*/
+		typedef ResultType (*entry_type)(BaseType&, VisitorType&);
+		/**@brief Integral value of the enumerated type handled by a
+		 *   handler, or @c 0 for a fallback.*/
+		template <typename HandlerType>
+		static constexpr long long value_of() {
+			if constexpr (is_typed_visit_handler<enum_type,
+				HandlerType>::value) {
+				return static_cast<long long>(
+					visit_handler_traits<HandlerType>::node_type::TYPE);
+			}
+			else {
+				return 0;
+			}
+		}
+		/**@brief Whether each handler handles a single class type.*/
+		static constexpr bool TYPED[] = {
+			is_typed_visit_handler<enum_type, HandlerTypes>::value... };
+		/**@brief Integral value of the enumerated type each handler
+		 *   handles.*/
+		static constexpr long long VALUES[] = { value_of<HandlerTypes>()... };
+		/**@brief Function calling each handler.*/
+		static constexpr entry_type ENTRIES[] = {
+			&visit_handler_call<ResultType, HandlerTypes, BaseType,
+				VisitorType>... };
+		/**@brief Smallest enumerated type handled, as an integer.*/
+		static constexpr long long min_value() {
+			long long m = 0;
+			bool found = false;
+			for (size_t i=0; i<sizeof...(HandlerTypes); i++) {
+				if (TYPED[i] && (! found || VALUES[i] < m)) {
+					m = VALUES[i];
+					found = true;
+				}
+			}
+			return m;
+		}
+		/**@brief Number of handlers that handle a single class type.*/
+		static constexpr size_t ntyped() {
+			size_t n = 0;
+			for (size_t i=0; i<sizeof...(HandlerTypes); i++) {
+				n += TYPED[i] ? 1 : 0;
+			}
+			return n;
+		}
+		/**@brief Number of enumerated types from the smallest handled to
+		 *   the largest, or @c 0 if none is.*/
+		static constexpr size_t span() {
+			long long m = min_value();
+			for (size_t i=0; i<sizeof...(HandlerTypes); i++) {
+				if (TYPED[i] && VALUES[i] > m) {
+					m = VALUES[i];
+				}
+			}
+			return (ntyped() == 0) ? 0
+				: static_cast<size_t>(m - min_value()) + 1;
+		}
+		/**@brief Whether to dispatch through the table rather than with
+		 *   @ref visit_chain: only if there are enough handlers that the
+		 *   chain would be long, and their types are dense enough that the
+		 *   table stays small.*/
+		static constexpr bool ENABLED = (ntyped() >= 8)
+			&& span() <= 4 * ntyped();
+		/**@brief Builds the table. Where two handlers handle the same type,
+		 *   the first one wins, as with @ref visit_chain.*/
+		static constexpr std::array<entry_type, ENABLED ? span() : 1>
+			make() {
+			std::array<entry_type, ENABLED ? span() : 1> table{};
+			for (size_t i=0; i<table.size(); i++) {
+				table[i] = &visit_fallback_call<ResultType, BaseType,
+					VisitorType>;
+			}
+			for (size_t i=sizeof...(HandlerTypes); i-->0; ) {
+				if (TYPED[i]) {
+					table[static_cast<size_t>(VALUES[i] - min_value())]
+						= ENTRIES[i];
+				}
+			}
+			return table;
+		}
+		/**@brief Function calling the handler for each enumerated type,
+		 *   starting from @ref min_value.*/
+		static constexpr std::array<entry_type, ENABLED ? span() : 1> TABLE
+			= make();
+	};
+	
+	/**@brief Calls the handler for an AST node's type, or the fallback,
+	 *   through a @ref visit_table if it's enabled, or @ref visit_chain
+	 *   otherwise.*/
+	template <typename ResultType, typename... HandlerTypes,
+		typename BaseType, typename VisitorType>
+	inline ResultType visit_dispatch(BaseType& n, VisitorType& visitor) {
+		typedef visit_table<ResultType, BaseType, VisitorType,
+			HandlerTypes...> table_type;
+		if constexpr (table_type::ENABLED) {
+			long long i = static_cast<long long>(n.type())
+				- table_type::min_value();
+			if (i >= 0 && static_cast<size_t>(i) < table_type::span()) {
+				return table_type::TABLE[static_cast<size_t>(i)](n, visitor);
+			}
+			return visit_fallback_call<ResultType>(n, visitor);
+		}
+		else {
+			return visit_chain<ResultType, HandlerTypes...>(n, visitor);
+		}
+	}
+	
+	/**@brief Calls the handler for an AST node's class type, as picked by
+	 *   its enumerated type, instead of a chain of @c type() checks and
+	 *   casts.
+	 * @tparam AstEnumType Data type for enumerated AST node types.
+	 * @tparam HandlerTypes Data types for handlers.
+	 * @param n AST node.
+	 * @param visitor Handlers, each taking a reference to a class type
+	 *   derived from @ref ast_typed_base_type, plus optionally a fallback
+	 *   taking a reference to @ref ast_base_type (or a generic lambda).
+	 *   They're called through this reference, never copied, so that state
+	 *   kept by @c mutable handlers lasts from one call to the next.
+	 * @return Result of the handler called. Every handler must return the
+	 *   same type. If no handler matches and there is no fallback, a
+	 *   value-initialized result is returned.
+	 * @details The class type handled by each handler, and so its enumerated
+	 *   type (<tt>ast_typed_base_type::TYPE</tt>), is found at compile time
+	 *   from the parameter of its call operator. With a few handlers, the
+	 *   node's type is compared with each handler's in turn, and all of the
+	 *   handlers can be inlined into the traversal that calls this. With
+	 *   eight or more handlers for closely numbered types, a jump table
+	 *   built at compile time is used instead.
+	 * @warning As with @ref node_cast, each enumerated value must be
+	 *   associated with exactly one class type.*/
+	template <typename AstEnumType, typename... HandlerTypes>
+	inline typename visit_result<ast_base_type<AstEnumType>,
+		overloaded<HandlerTypes...> >::type visit(
+		ast_base_type<AstEnumType>& n, overloaded<HandlerTypes...>& visitor) {
+		return visit_dispatch<typename visit_result<ast_base_type<AstEnumType>,
+			overloaded<HandlerTypes...> >::type, HandlerTypes...>(n, visitor);
+	}
+	
+	/**@brief Same as the other @ref visit, for @c const handlers, none of
+	 *   which can be @c mutable.*/
+	template <typename AstEnumType, typename... HandlerTypes>
+	inline typename visit_result<ast_base_type<AstEnumType>,
+		const overloaded<HandlerTypes...> >::type visit(
+		ast_base_type<AstEnumType>& n,
+		const overloaded<HandlerTypes...>& visitor) {
+		return visit_dispatch<typename visit_result<ast_base_type<AstEnumType>,
+			const overloaded<HandlerTypes...> >::type, HandlerTypes...>(n,
+			visitor);
+	}
+	
+	/**@brief Same as the other @ref visit, for handlers constructed in the
+	 *   call.*/
+	template <typename AstEnumType, typename... HandlerTypes>
+	inline typename visit_result<ast_base_type<AstEnumType>,
+		overloaded<HandlerTypes...> >::type visit(
+		ast_base_type<AstEnumType>& n, overloaded<HandlerTypes...>&& visitor) {
+		return visit(n, visitor);
+	}
+	
+	/**@brief Same as the other @ref visit, for a @c const AST node, whose
+	 *   handlers take @c const references.*/
+	template <typename AstEnumType, typename... HandlerTypes>
+	inline typename visit_result<const ast_base_type<AstEnumType>,
+		overloaded<HandlerTypes...> >::type visit(
+		const ast_base_type<AstEnumType>& n,
+		overloaded<HandlerTypes...>& visitor) {
+		return visit_dispatch<typename visit_result<
+			const ast_base_type<AstEnumType>, overloaded<HandlerTypes...> >::type,
+			HandlerTypes...>(n, visitor);
+	}
+	
+	/**@brief Same as the other @ref visit, for a @c const AST node and
+	 *   @c const handlers.*/
+	template <typename AstEnumType, typename... HandlerTypes>
+	inline typename visit_result<const ast_base_type<AstEnumType>,
+		const overloaded<HandlerTypes...> >::type visit(
+		const ast_base_type<AstEnumType>& n,
+		const overloaded<HandlerTypes...>& visitor) {
+		return visit_dispatch<typename visit_result<
+			const ast_base_type<AstEnumType>,
+			const overloaded<HandlerTypes...> >::type, HandlerTypes...>(n,
+			visitor);
+	}
+	
+	/**@brief Same as the other @ref visit, for a @c const AST node and
+	 *   handlers constructed in the call.*/
+	template <typename AstEnumType, typename... HandlerTypes>
+	inline typename visit_result<const ast_base_type<AstEnumType>,
+		overloaded<HandlerTypes...> >::type visit(
+		const ast_base_type<AstEnumType>& n,
+		overloaded<HandlerTypes...>&& visitor) {
+		return visit(n, visitor);
+	}
+	
+	
+	
+	/**@brief Factory constructing AST nodes in place on a monotonic arena,
+	 *   so that a whole AST is freed at once instead of node by node.
+	 * @tparam AstEnumType Data type for enumerated AST node types.
+	 * @details Grammar actions call @ref make instead of @c new, e.g., through
+	 *   a factory held by the parsing context:
+	 * @code{.unparsed}
+	 * expr(R) ::= expr(A) LOGOR expr(B). {
+	 *   R = ctx->nodes.make<ast_binop_logor>(span_loc(A->loc(), B->loc()), A, B);
+	 * }
+	 * @endcode
+	 * Memory comes from a @c std::pmr::monotonic_buffer_resource, so
+	 * constructing a node is a pointer bump. Nodes are destroyed, in reverse
+	 * order of construction, only by @ref release or the destructor, which
+	 * then free all of the memory at once. Since the factory owns every node,
+	 * nodes it makes must hold their child nodes by raw pointer (as
+	 * @ref ast_base_type does), never deleting them. Members that allocate,
+	 * such as strings, can come from @ref resource as well.
+	 * 
+	 * A factory is not thread-safe; use one per thread, as with
+	 * @ref parse_arena, whose @ref parse_arena::resource can serve as the
+	 * upstream resource.*/
+	template <typename AstEnumType>
+	class ast_node_arena {
+		/**@brief Data type for the base class of all nodes made.*/
+		using node_type = ast_base_type<AstEnumType>;
+		/**@brief Record of a node made, preceding it in the arena and linked
+		 *   to the record of the node made before it.*/
+		struct node_header {
+			/**@brief Node made.*/
+			node_type *node;
+			/**@brief Record of the node made before it, or @c nullptr.*/
+			node_header *prev;
+		};
+		/**@brief Memory resource handing out the arena's memory.*/
+		std::pmr::monotonic_buffer_resource resource_;
+		/**@brief Record of the node made last, or @c nullptr.*/
+		node_header *last_;
+		/**@brief Number of nodes made since construction or the last
+		 *   @ref release.*/
+		size_t count_;
+		/**@brief Destroys every node made, without freeing memory.*/
+		void destroy() {
+			for (node_header *h=last_; h!=nullptr; h=h->prev) {
+				h->node->~node_type();
+			}
+			last_ = nullptr;
+			count_ = 0;
+		}
+	public:
+		/**@brief Constructor.
+		 * @param initial_size Size of the first block of memory to be taken
+		 *   from @c upstream. Later blocks grow geometrically.
+		 * @param upstream Memory resource that blocks are taken from.*/
+		explicit ast_node_arena(const size_t initial_size = 64 * 1024,
+			std::pmr::memory_resource *const upstream
+				= std::pmr::get_default_resource())
+			: resource_(initial_size, upstream), last_(nullptr), count_(0) {}
+		ast_node_arena(const ast_node_arena&) = delete;
+		ast_node_arena& operator=(const ast_node_arena&) = delete;
+		/**@brief Destructor. Destroys every node made.*/
+		~ast_node_arena() { destroy(); }
+		/**@brief Constructs an AST node on the arena.
+		 * @tparam NodeType Class of node, derived from @ref ast_base_type.
+		 * @tparam ArgTypes Data types for @c args.
+		 * @param args Arguments to the constructor of @c NodeType.
+		 * @return Node, owned by this factory.*/
+		template <typename NodeType, typename... ArgTypes>
+		NodeType* make(ArgTypes&&... args) {
+			static_assert(is_ast_node_subclass_type<AstEnumType,
+				NodeType>::value, "expected NodeType to be derived from "
+				"ast_base_type<AstEnumType>");
+			void *hmem = resource_.allocate(sizeof(node_header),
+				alignof(node_header));
+			void *nmem = resource_.allocate(sizeof(NodeType),
+				alignof(NodeType));
+			NodeType *node = new (nmem) NodeType(
+				std::forward<ArgTypes>(args)...);
+			last_ = new (hmem) node_header{ node, last_ };
+			count_++;
+			return node;
+		}
+		/**@brief Destroys every node made, then frees all of the arena's
+		 *   memory.
+		 * @warning No node made by this factory may be used after this.*/
+		void release() {
+			destroy();
+			resource_.release();
+		}
+		/**@brief Number of nodes made since construction or the last
+		 *   @ref release.*/
+		size_t size() const { return count_; }
+		/**@brief Memory resource for @c std::pmr members of nodes, freed
+		 *   along with them.*/
+		std::pmr::memory_resource *resource() { return &resource_; }
+	};
+	
+	
+	
+	template <typename AstEnumType>
+	class flat_ast;
+	
+	/**@brief Handle to a node of a @ref flat_ast, with the read-only part of
+	 *   the @ref ast_base_type interface, so that code written against
+	 *   pointer-based ASTs can be moved over to flat ones.
+	 * @tparam AstEnumType Data type for enumerated AST node types.
+	 * @details A handle is just the AST and the node's ID, and is meant to be
+	 *   passed by value. It stays valid as long as the AST does, even as
+	 *   nodes are added.*/
+	template <typename AstEnumType>
+	class flat_ast_node {
+	public:
+		/**@brief Data type for a node ID.*/
+		typedef std::uint32_t node_id;
+		/**@brief Iterator over the child nodes of a node, in order of
+		 *   addition.*/
+		class child_iterator {
+			/**@brief AST.*/
+			const flat_ast<AstEnumType> *ast_;
+			/**@brief Child node, or @ref flat_ast::NO_NODE past the last.*/
+			node_id id_;
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef flat_ast_node value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const flat_ast_node* pointer;
+			typedef flat_ast_node reference;
+			child_iterator(const flat_ast<AstEnumType>& ast, const node_id id)
+				: ast_(&ast), id_(id) {}
+			flat_ast_node operator*() const { return ast_->node(id_); }
+			child_iterator& operator++() {
+				id_ = ast_->next_sibling(id_);
+				return *this;
+			}
+			child_iterator operator++(int) {
+				child_iterator i = *this;
+				++(*this);
+				return i;
+			}
+			bool operator==(const child_iterator& other) const {
+				return id_ == other.id_;
+			}
+			bool operator!=(const child_iterator& other) const {
+				return id_ != other.id_;
+			}
+		};
+		/**@brief Range of the child nodes of a node.*/
+		class child_range {
+			/**@brief AST.*/
+			const flat_ast<AstEnumType> *ast_;
+			/**@brief Parent node.*/
+			node_id id_;
+		public:
+			child_range(const flat_ast<AstEnumType>& ast, const node_id id)
+				: ast_(&ast), id_(id) {}
+			child_iterator begin() const {
+				return child_iterator(*ast_, ast_->first_child(id_));
+			}
+			child_iterator end() const {
+				return child_iterator(*ast_, flat_ast<AstEnumType>::NO_NODE);
+			}
+			bool empty() const {
+				return ast_->first_child(id_) == flat_ast<AstEnumType>::NO_NODE;
+			}
+			/**@brief Number of child nodes, counted by walking them.*/
+			size_t size() const {
+				return static_cast<size_t>(std::distance(begin(), end()));
+			}
+		};
+	private:
+		/**@brief AST.*/
+		const flat_ast<AstEnumType> *ast_;
+		/**@brief Node.*/
+		node_id id_;
+	public:
+		/**@brief Constructor.
+		 * @param ast AST.
+		 * @param id Node, which must be in @c ast.*/
+		flat_ast_node(const flat_ast<AstEnumType>& ast, const node_id id)
+			: ast_(&ast), id_(id) {
+			assert(id < ast.size());
+		}
+		/**@brief Node ID.*/
+		node_id id() const { return id_; }
+		/**@brief Same as @ref ast_base_type::type.*/
+		AstEnumType type() const { return ast_->type(id_); }
+		/**@brief Same as @ref ast_base_type::parent.*/
+		flat_ast_node parent() const { return ast_->node(ast_->parent(id_)); }
+		/**@brief Same as @ref ast_base_type::is_root.*/
+		bool is_root() const { return ast_->is_root(id_); }
+		/**@brief Same as @ref ast_base_type::root.*/
+		flat_ast_node root() const {
+			node_id n = id_;
+			while (! ast_->is_root(n)) {
+				n = ast_->parent(n);
+			}
+			return ast_->node(n);
+		}
+		/**@brief Same as @ref ast_base_type::childs, as a range of handles.*/
+		child_range childs() const { return child_range(*ast_, id_); }
+		/**@brief Same as @ref ast_base_type::loc.*/
+		text_loc loc() const { return ast_->loc(id_); }
+		/**@brief Index into the application's side table for this node's
+		 *   type, or @ref flat_ast::NO_PAYLOAD.*/
+		std::uint32_t payload() const { return ast_->payload(id_); }
+		bool operator==(const flat_ast_node& other) const {
+			return ast_ == other.ast_ && id_ == other.id_;
+		}
+		bool operator!=(const flat_ast_node& other) const {
+			return !(*this == other);
+		}
+	};
+	
+	/**@brief AST stored as a structure of arrays indexed by 32-bit node IDs,
+	 *   instead of as nodes linked by pointers.
+	 * @tparam AstEnumType Data type for enumerated AST node types.
+	 * @details Each node has a type, a location, and parent, first child,
+	 *   last child, and next sibling IDs, each kept in its own array, so
+	 *   that a pass over one of them (e.g., all node types) reads memory in
+	 *   order. Data that only some types of nodes have, such as names or
+	 *   literal values, goes in side tables kept by the application, with
+	 *   each node's payload being its index into the table for its type.
+	 * 
+	 * Grammar actions build into an AST held by the parsing context, with
+	 * node IDs as the semantic values of nonterminals:
+	 * @code{.unparsed}
+	 * %type expr { uint32_t }
+	 * expr(R) ::= expr(A) LOGOR expr(B). {
+	 *   R = ctx->ast.add_node(nt::BINOP_LOGOR,
+	 *     span_loc(ctx->ast.loc(A), ctx->ast.loc(B)));
+	 *   ctx->ast.add_childs(R, A, B);
+	 * }
+	 * decl(R) ::= IDENT(N) ASSIGN expr(E) SEMI(S). {
+	 *   ctx->names.push_back(N->mtext);
+	 *   R = ctx->ast.add_node(nt::DATA_DECL, span_loc(N->loc, S->loc),
+	 *     ctx->names.size() - 1);
+	 *   ctx->ast.add_child(R, E);
+	 * }
+	 * @endcode
+	 * Since nodes aren't objects, nothing has to be freed node by node, and
+	 * @ref node gives a @ref flat_ast_node handle for code written against
+	 * @ref ast_base_type.*/
+	template <typename AstEnumType>
+	class flat_ast {
+		static_assert(std::is_enum<AstEnumType>::value
+			|| std::is_integral<AstEnumType>::value, "AstEnumType must be an "
+			"integral or enumeration type");
+	public:
+		/**@brief Data type for a node ID, which is the node's index in each
+		 *   array.*/
+		typedef std::uint32_t node_id;
+		/**@brief ID standing for no node, as for the first child of a node
+		 *   with no child nodes.*/
+		static constexpr node_id NO_NODE = ~node_id(0);
+		/**@brief Payload of a node with no data in a side table.*/
+		static constexpr std::uint32_t NO_PAYLOAD = ~std::uint32_t(0);
+	private:
+		/**@brief Type of each node.*/
+		std::vector<AstEnumType> types_;
+		/**@brief Location in parsed source of each node.*/
+		std::vector<text_loc> locs_;
+		/**@brief Parent of each node, which is the node itself for a root
+		 *   node (as for @ref ast_base_type::parent).*/
+		std::vector<node_id> parents_;
+		/**@brief First child of each node, or @ref NO_NODE.*/
+		std::vector<node_id> first_childs_;
+		/**@brief Last child of each node, or @ref NO_NODE.*/
+		std::vector<node_id> last_childs_;
+		/**@brief Next sibling of each node, or @ref NO_NODE.*/
+		std::vector<node_id> next_siblings_;
+		/**@brief Index of each node into a side table, or @ref NO_PAYLOAD.*/
+		std::vector<std::uint32_t> payloads_;
+	public:
+		/**@brief Number of nodes.*/
+		size_t size() const { return types_.size(); }
+		/**@brief Makes room for at least @c n nodes.*/
+		void reserve(const size_t n) {
+			types_.reserve(n);
+			locs_.reserve(n);
+			parents_.reserve(n);
+			first_childs_.reserve(n);
+			last_childs_.reserve(n);
+			next_siblings_.reserve(n);
+			payloads_.reserve(n);
+		}
+		/**@brief Removes all nodes.*/
+		void clear() {
+			types_.clear();
+			locs_.clear();
+			parents_.clear();
+			first_childs_.clear();
+			last_childs_.clear();
+			next_siblings_.clear();
+			payloads_.clear();
+		}
+		/**@brief Adds a node, as the root node of its own AST with no child
+		 *   nodes.
+		 * @param type Enumerated node type.
+		 * @param loc Location of original text in parsed source.
+		 * @param payload Index of the node's data in a side table.
+		 * @return ID of new node.*/
+		node_id add_node(const AstEnumType type, const text_loc& loc,
+			const std::uint32_t payload = NO_PAYLOAD) {
+			assert(size() < NO_NODE);
+			const node_id id = static_cast<node_id>(size());
+			types_.push_back(type);
+			locs_.push_back(loc);
+			parents_.push_back(id);
+			first_childs_.push_back(NO_NODE);
+			last_childs_.push_back(NO_NODE);
+			next_siblings_.push_back(NO_NODE);
+			payloads_.push_back(payload);
+			return id;
+		}
+		/**@brief Assigns a node as the last child of another, as with
+		 *   @ref ast_base_type::add_child, in constant time.
+		 * @param parent Parent node.
+		 * @param child Node to set as a child of @c parent, which must be
+		 *   a root node or already a child of @c parent.
+		 * @details If @c child is @ref NO_NODE or already a child of
+		 *   @c parent, then nothing happens.*/
+		void add_child(const node_id parent, const node_id child) {
+			assert(parent < size());
+			if (child == NO_NODE || parents_[child] == parent) {
+				return;
+			}
+			assert(child < size());
+			assert(is_root(child));
+			parents_[child] = parent;
+			if (last_childs_[parent] == NO_NODE) {
+				first_childs_[parent] = child;
+			}
+			else {
+				next_siblings_[last_childs_[parent]] = child;
+			}
+			last_childs_[parent] = child;
+		}
+		/**@brief Tail case for @ref add_childs. Does nothing.*/
+		void add_childs(const node_id parent) {
+			LARGEMELON_UNUSED_PARAM(parent);
+		}
+		/**@brief Assigns multiple nodes as children of another, as with
+		 *   @ref ast_base_type::add_childs.
+		 * @tparam ChildTypes Data types for @c childs.
+		 * @param parent Parent node.
+		 * @param child First child node.
+		 * @param childs Next child nodes.*/
+		template <typename... ChildTypes>
+		void add_childs(const node_id parent, const node_id child,
+			ChildTypes... childs) {
+			add_child(parent, child);
+			add_childs(parent, childs...);
+		}
+		/**@brief Enumerated type of a node.*/
+		AstEnumType type(const node_id id) const { return types_[id]; }
+		/**@brief Location of a node's original text in parsed source.*/
+		text_loc loc(const node_id id) const { return locs_[id]; }
+		/**@brief Sets the location of a node's original text.*/
+		void set_loc(const node_id id, const text_loc& loc) {
+			locs_[id] = loc;
+		}
+		/**@brief Index of a node's data into a side table.*/
+		std::uint32_t payload(const node_id id) const {
+			return payloads_[id];
+		}
+		/**@brief Sets the index of a node's data into a side table.*/
+		void set_payload(const node_id id, const std::uint32_t payload) {
+			payloads_[id] = payload;
+		}
+		/**@brief Parent of a node, which is the node itself for a root
+		 *   node.*/
+		node_id parent(const node_id id) const { return parents_[id]; }
+		/**@brief Whether a node is the root node of its AST.*/
+		bool is_root(const node_id id) const { return parents_[id] == id; }
+		/**@brief First child of a node, or @ref NO_NODE.*/
+		node_id first_child(const node_id id) const {
+			return first_childs_[id];
+		}
+		/**@brief Next sibling of a node, or @ref NO_NODE.*/
+		node_id next_sibling(const node_id id) const {
+			return next_siblings_[id];
+		}
+		/**@brief Type of every node, indexed by node ID.*/
+		const std::vector<AstEnumType>& types() const { return types_; }
+		/**@brief Location of every node, indexed by node ID.*/
+		const std::vector<text_loc>& locs() const { return locs_; }
+		/**@brief Handle to a node, for code written against
+		 *   @ref ast_base_type.*/
+		flat_ast_node<AstEnumType> node(const node_id id) const {
+			return flat_ast_node<AstEnumType>(*this, id);
+		}
+		/**@brief Shifts the text locations of all nodes past an edit of the
+		 *   parsed source, as with @ref ast_base_type::shift_locs, in one pass
+		 *   over the locations.*/
+		void shift_locs(const text_loc_delta& delta) {
+			for (text_loc& loc: locs_) {
+				if (loc != EMPTY_TEXT_LOC) {
+					shift_text_loc(loc, delta);
+				}
+			}
+		}
+	};
+	
+	
+	
+	/**@brief Receives top-level AST nodes as soon as they are reduced by the
+	 *   parser, hands them to a consumer, and then releases them, so that the
+	 *   whole AST never has to be held in memory at once.
+	 * @tparam AstEnumType Data type for enumerated AST node types.
+	 * @details Instead of appending each completed top-level node (a child of
+	 *   the root node, such as a declaration) to the root node, the grammar
+	 *   action emits it to a sink held by the parsing context:
+	 * @code{.unparsed}
+	 * program(R) ::= program(L) decl(D). {
+	 *   R = L;
+	 *   if (ctx->sink != nullptr) {
+	 *     ctx->sink->emit(D);
+	 *   }
+	 *   else {
+	 *     R->append(D);
+	 *   }
+	 * }
+	 * @endcode
+	 * Peak memory then depends on the largest top-level construct, not on the
+	 * size of the input. The releaser defaults to @c delete, which frees the
+	 * node along with whatever it owns, such as its child nodes and strings.
+	 * For nodes allocated from an arena, it might instead give back the
+	 * arena's memory once it's known to be unused.*/
+	template <typename AstEnumType>
+	class ast_stream_sink {
+	public:
+		/**@brief Data type for a function processing a top-level node.*/
+		using consumer_func_type
+			= std::function<void(ast_base_type<AstEnumType>&)>;
+		/**@brief Data type for a function releasing a processed top-level
+		 *   node.*/
+		using releaser_func_type
+			= std::function<void(ast_base_type<AstEnumType>*)>;
+	private:
+		/**@brief Function processing each top-level node.*/
+		consumer_func_type consumer_;
+		/**@brief Function releasing each processed top-level node.*/
+		releaser_func_type releaser_;
+		/**@brief Number of nodes emitted so far.*/
+		size_t count_;
+	public:
+		/**@brief Constructor.
+		 * @param consumer Function processing each top-level node, such as
+		 *   by analyzing or serializing it.
+		 * @param releaser Function releasing each processed top-level node,
+		 *   or empty to @c delete it.*/
+		explicit ast_stream_sink(consumer_func_type consumer,
+			releaser_func_type releaser = nullptr)
+			: consumer_(std::move(consumer)), releaser_(std::move(releaser)),
+			count_(0) {}
+		/**@brief Hands a completed top-level node to the consumer, then
+		 *   releases it.
+		 * @param node Node, which must not have been added to a parent node
+		 *   (since the parent would be left pointing to a released node). If
+		 *   @c nullptr, then nothing happens.*/
+		void emit(ast_base_type<AstEnumType>* const node) {
+			if (node == nullptr) {
+				return;
+			}
+			assert(node->is_root());
+			count_++;
+			consumer_(*node);
+			if (releaser_) {
+				releaser_(node);
+			}
+			else {
+				delete node;
+			}
+		}
+		/**@brief Number of nodes emitted so far.*/
+		size_t count() const { return count_; }
+	};
+	
+	
+	
+	/**@brief Collection of registers managed by a Ragel-generated scanner.
+	 * @details To use this in the same C++ source file as a Ragel machine
+	 *   instantiation:
+	 * @code{.cpp}
+	 * largemelon::ragel_scanner_pers_type rp;
+	 * 
+	 * %% access rp.;
+	 * %% variable p   rp.p;
+	 * %% variable pe  rp.pe;
+	 * %% variable eof rp.eof;
+	 * %% write data;
+	 * 
+	 * // set up parser...
+	 * 
+	 * %% write init;
+	 * %% write exec;
+	 * 
+	 * // ...
+	 * @endcode
+	 * See the Ragel user manual for details.*/
+	struct ragel_scanner_pers_type {
+		/**@brief Pointer to first input character.*/
+		const char *p;
+		/**@brief Pointer to just after last input character.*/
+		const char *pe;
+		/**@brief Pointer to end of opened file, if applicable.*/
+		const char *eof;
+		/**@brief Register for current internal parser state.*/
+		int cs;
 		/**@brief Register for most recent successful pattern match.*/
 		int act;
 		/**@brief Pointer to first character of found token.*/
@@ -964,6 +3529,1528 @@ namespace largemelon {
 	
 	
 	
+	/**@brief Allocates zeroed, aligned memory for input text, with room for
+	 *   the NUL sentinel and padding that follow it.
+	 * @param capacity Number of input characters.
+	 * @return Memory aligned to @ref INPUT_BUFFER_ALIGNMENT, with
+	 *   <tt>capacity + INPUT_BUFFER_PADDING + 1</tt> zero bytes. Free it with
+	 *   @ref padded_free.*/
+	inline char *padded_alloc(const size_t capacity) {
+		size_t n = capacity + INPUT_BUFFER_PADDING + 1;
+		char *mem = static_cast<char *>(::operator new(n,
+			std::align_val_t(INPUT_BUFFER_ALIGNMENT)));
+		std::memset(mem, 0, n);
+		return mem;
+	}
+	
+	/**@brief Frees memory allocated by @ref padded_alloc.
+	 * @param mem Allocated memory, or @c nullptr.*/
+	inline void padded_free(char *const mem) {
+		if (mem != nullptr) {
+			::operator delete(mem, std::align_val_t(INPUT_BUFFER_ALIGNMENT));
+		}
+	}
+	
+	
+	
+	/**@brief Read-only input text for a Ragel-generated scanner, released
+	 *   when this object is destroyed.
+	 * @details Files are memory-mapped where @ref LARGEMELON_HAS_MMAP is
+	 *   set, so that scanning can start without first copying the whole file
+	 *   into a @c std::string. The kernel is advised that the mapping will be
+	 *   read sequentially, and soon. Pipes and other streams that can't be
+	 *   mapped are read into memory instead.
+	 * 
+	 * However it's filled, the input text is page-aligned (or aligned to
+	 * @ref INPUT_BUFFER_ALIGNMENT) and followed by a NUL sentinel and then by
+	 * @ref INPUT_BUFFER_PADDING more zero bytes. Helpers with a @c _padded
+	 * suffix rely on this to read past the end of the text without checking.
+	 * @code{.cpp}
+	 * largemelon::input_buffer buf;
+	 * if (buf.map_file(fpath) != 0) {
+	 *   // handle error...
+	 * }
+	 * largemelon::ragel_scanner_pers_type rp;
+	 * largemelon::set_scanner_input(rp, buf);
+	 * %% write init;
+	 * %% write exec;
+	 * @endcode*/
+	class input_buffer {
+		/**@brief Pointer to first input character.*/
+		const char *data_;
+		/**@brief Number of input characters.*/
+		size_t size_;
+		/**@brief Number of bytes mapped at @c data_, or @c 0 if @c data_ is
+		 *   not a memory-mapped region.*/
+		size_t mapped_size_;
+		/**@brief Heap-allocated input characters, if not memory-mapped.*/
+		char *heap_;
+		/**@brief Number of bytes allocated at @c heap_.*/
+		size_t heap_capacity_;
+		/**@brief Zero bytes standing in for the text of an empty buffer.*/
+		static const char *empty_data() {
+			alignas(64) static const char EMPTY[INPUT_BUFFER_PADDING + 1] = {};
+			return EMPTY;
+		}
+		/**@brief Allocates zeroed heap memory for @c capacity input characters,
+		 *   plus padding, keeping the first @c keep characters of the current
+		 *   heap memory.*/
+		void grow_heap(const size_t capacity, const size_t keep) {
+			char *heap = padded_alloc(capacity);
+			if (keep > 0) {
+				std::memcpy(heap, heap_, keep);
+			}
+			free_heap();
+			heap_ = heap;
+			heap_capacity_ = capacity;
+		}
+		/**@brief Frees heap memory, if any.*/
+		void free_heap() {
+			padded_free(heap_);
+			heap_ = nullptr;
+			heap_capacity_ = 0;
+		}
+	public:
+		/**@brief Constructor, for an empty buffer.*/
+		input_buffer() : data_(empty_data()), size_(0), mapped_size_(0),
+			heap_(nullptr), heap_capacity_(0) {}
+		input_buffer(const input_buffer&) = delete;
+		input_buffer& operator=(const input_buffer&) = delete;
+		/**@brief Move constructor. @c other is left empty.*/
+		input_buffer(input_buffer&& other) noexcept : input_buffer() {
+			*this = std::move(other);
+		}
+		/**@brief Move assignment. @c other is left empty.*/
+		input_buffer& operator=(input_buffer&& other) noexcept {
+			if (this != &other) {
+				close();
+				std::swap(data_, other.data_);
+				std::swap(size_, other.size_);
+				std::swap(mapped_size_, other.mapped_size_);
+				std::swap(heap_, other.heap_);
+				std::swap(heap_capacity_, other.heap_capacity_);
+			}
+			return *this;
+		}
+		/**@brief Destructor. Unmaps or frees the input text.*/
+		~input_buffer() { close(); }
+		/**@brief Replaces the contents of this buffer with those of a file,
+		 *   memory-mapping it if possible.
+		 * @param fpath Path to a regular file.
+		 * @return @c 0 on success, nonzero (an @c errno value, if available)
+		 *   otherwise. On failure, this buffer is left empty.
+		 * @note Pipes and other non-regular files can't be memory-mapped; use
+		 *   @ref read_stream for those.
+		 * @internal The file is mapped over an anonymous mapping that is
+		 *   large enough for the padding, so that the padding is made of
+		 *   zeroed pages (or of the zeroed tail of the file's last page),
+		 *   rather than of pages past the end of the file, which would raise
+		 *   @c SIGBUS if read.*/
+		int map_file(const std::filesystem::path& fpath) {
+			close();
+#if LARGEMELON_HAS_MMAP
+			int fd = ::open(fpath.c_str(), O_RDONLY);
+			if (fd < 0) {
+				return errno;
+			}
+			struct stat st;
+			if (::fstat(fd, &st) != 0) {
+				int rc = errno;
+				::close(fd);
+				return rc;
+			}
+			if (st.st_size > 0) {
+				size_t size = static_cast<size_t>(st.st_size);
+				size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+				size_t total = ((size + INPUT_BUFFER_PADDING + 1 + page - 1)
+					/ page) * page;
+				void *base = ::mmap(nullptr, total, PROT_READ,
+					MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+				void *addr = (base == MAP_FAILED) ? MAP_FAILED : ::mmap(base,
+					size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+				if (addr == MAP_FAILED) {
+					int rc = errno;
+					if (base != MAP_FAILED) {
+						::munmap(base, total);
+					}
+					::close(fd);
+					return rc;
+				}
+				::madvise(addr, size, MADV_SEQUENTIAL);
+				::madvise(addr, size, MADV_WILLNEED);
+				data_ = static_cast<const char *>(addr);
+				size_ = size;
+				mapped_size_ = total;
+			}
+			::close(fd);
+			return 0;
+#else
+			return read_file(fpath);
+#endif
+		}
+		/**@brief Replaces the contents of this buffer with those of a file,
+		 *   read into memory.
+		 * @param fpath Path to file.
+		 * @return @c 0 on success, nonzero otherwise. On failure, this buffer
+		 *   is left empty.*/
+		int read_file(const std::filesystem::path& fpath) {
+			close();
+			std::ifstream ifs(fpath, std::ios::binary);
+			if (! ifs) {
+				return 1;
+			}
+			return read_stream(ifs);
+		}
+		/**@brief Replaces the contents of this buffer with everything that's
+		 *   left in an input stream, such as @c std::cin.
+		 * @param is Input stream.
+		 * @return @c 0 on success, nonzero otherwise. On failure, this buffer
+		 *   is left empty.*/
+		int read_stream(std::istream& is) {
+			close();
+			size_t size = 0;
+			grow_heap(64 * 1024, 0);
+			while (is.read(heap_ + size, heap_capacity_ - size)
+				|| is.gcount() > 0) {
+				size += static_cast<size_t>(is.gcount());
+				if (size == heap_capacity_) {
+					grow_heap(2 * heap_capacity_, size);
+				}
+			}
+			if (is.bad()) {
+				close();
+				return 1;
+			}
+			data_ = heap_;
+			size_ = size;
+			return 0;
+		}
+		/**@brief Replaces the contents of this buffer with a copy of some
+		 *   text.
+		 * @param data Pointer to first character of text.
+		 * @param size Number of characters of text.*/
+		void assign(const char *data, const size_t size) {
+			close();
+			if (size > 0) {
+				grow_heap(size, 0);
+				std::memcpy(heap_, data, size);
+				data_ = heap_;
+				size_ = size;
+			}
+		}
+		/**@brief Strips a UTF-8 byte order mark from the input text and
+		 *   rewrites its newline sequences to @c '\n' (see
+		 *   @ref largemelon::normalize_newlines).
+		 * @param map Mapping back to the original text, which is replaced.
+		 * @details Heap-allocated text is normalized in place. Memory-mapped
+		 *   text, which is read-only, is normalized into heap memory in the
+		 *   same pass, and then unmapped.*/
+		void normalize_newlines(newline_map& map) {
+			if (data_ == heap_) {
+				size_t size = largemelon::normalize_newlines(heap_, size_,
+					heap_, map);
+				std::memset(heap_ + size, 0, size_ - size);
+				size_ = size;
+				return;
+			}
+			char *heap = padded_alloc(size_);
+			size_t capacity = size_;
+			size_t size = largemelon::normalize_newlines(data_, size_, heap,
+				map);
+			close();
+			heap_ = heap;
+			heap_capacity_ = capacity;
+			data_ = heap_;
+			size_ = size;
+		}
+		/**@brief Releases the input text, leaving this buffer empty.*/
+		void close() {
+#if LARGEMELON_HAS_MMAP
+			if (mapped_size_ > 0) {
+				::munmap(const_cast<char *>(data_), mapped_size_);
+			}
+#endif
+			free_heap();
+			data_ = empty_data();
+			size_ = 0;
+			mapped_size_ = 0;
+		}
+		/**@brief Pointer to first input character.
+		 * @details <tt>data()[size()]</tt> is a NUL sentinel, and it's
+		 *   followed by @ref INPUT_BUFFER_PADDING more zero bytes.*/
+		const char *data() const { return data_; }
+		/**@brief Number of input characters.*/
+		size_t size() const { return size_; }
+		/**@brief Whether this buffer is memory-mapped.*/
+		bool is_mapped() const { return mapped_size_ > 0; }
+	};
+	
+	/**@brief Points a Ragel-generated scanner at the entirety of some input
+	 *   text.
+	 * @param rp Scanner registers. Sets @c rp.p, @c rp.pe, and @c rp.eof.
+	 * @param data Pointer to first input character.
+	 * @param size Number of input characters.*/
+	inline void set_scanner_input(ragel_scanner_pers_type& rp,
+		const char *data, const size_t size) {
+		assert(data != nullptr);
+		rp.p = data;
+		rp.pe = data + size;
+		rp.eof = rp.pe;
+	}
+	
+	/**@brief Points a Ragel-generated scanner at the entire contents of an
+	 *   input buffer.
+	 * @param rp Scanner registers. Sets @c rp.p, @c rp.pe, and @c rp.eof.
+	 * @param buf Input buffer, which must outlive the scanning.*/
+	inline void set_scanner_input(ragel_scanner_pers_type& rp,
+		const input_buffer& buf) {
+		set_scanner_input(rp, buf.data(), buf.size());
+	}
+	
+	
+	
+	/**@brief Data type for a function that reads input text in pieces.
+	 * @details The function is called with a destination and the number of
+	 *   bytes of room there, and returns the number of bytes it wrote, @c 0 at
+	 *   the end of input, or a negative value on error.*/
+	using input_source_func_type = std::function<std::ptrdiff_t(char *,
+		size_t)>;
+	
+	/**@brief Input source reading from a standard input stream, such as
+	 *   @c std::cin.
+	 * @param is Input stream, which must outlive the returned function.*/
+	inline input_source_func_type istream_input_source(std::istream& is) {
+		return [&is](char *dest, const size_t n) -> std::ptrdiff_t {
+			is.read(dest, n);
+			if (is.bad()) {
+				return -1;
+			}
+			return static_cast<std::ptrdiff_t>(is.gcount());
+		};
+	}
+	
+#if LARGEMELON_HAS_MMAP
+	/**@brief Input source reading from a POSIX file descriptor, such as a
+	 *   pipe or standard input (@c 0).
+	 * @param fd Open file descriptor, which is not closed by this.*/
+	inline input_source_func_type fd_input_source(const int fd) {
+		return [fd](char *dest, const size_t n) -> std::ptrdiff_t {
+			ssize_t nread;
+			do {
+				nread = ::read(fd, dest, n);
+			} while (nread < 0 && errno == EINTR);
+			return static_cast<std::ptrdiff_t>(nread);
+		};
+	}
+#endif
+	
+	/**@brief Input source that reads ahead of its consumer on a background
+	 *   thread, so that a scanner fed by @ref chunked_scanner_input never
+	 *   waits on I/O unless it outpaces the underlying source.
+	 * @details The background thread fills up to @c depth buffers of
+	 *   @c chunk_size bytes each from the wrapped source, and calls to this
+	 *   function hand them out in order; with the default depth of @c 2, one
+	 *   chunk is read while the previous one is being scanned. This is most
+	 *   useful for pipes and standard input, which can't be memory-mapped.
+	 *   Copies share the same background thread, which is stopped when the
+	 *   last copy is destroyed.
+	 * @code{.cpp}
+	 * largemelon::chunked_scanner_input input(
+	 *   largemelon::read_ahead_input_source(largemelon::fd_input_source(0)));
+	 * @endcode
+	 * @warning The wrapped source is called from the background thread. If it
+	 *   blocks, as @c read on an idle pipe does, destroying the last copy
+	 *   of this blocks too, until the call returns.*/
+	class read_ahead_input_source {
+		/**@brief State shared between the consumer and the background
+		 *   thread.*/
+		struct shared_state {
+			/**@brief Wrapped source, only called by the background thread.*/
+			input_source_func_type source;
+			/**@brief Number of bytes to read per chunk.*/
+			size_t chunk_size;
+			/**@brief Ring of chunk buffers.*/
+			std::vector<std::vector<char>> bufs;
+			/**@brief Number of bytes read into each chunk buffer.*/
+			std::vector<size_t> lens;
+			/**@brief Index of the chunk buffer being consumed.*/
+			size_t head = 0;
+			/**@brief Number of bytes of the head buffer already consumed.*/
+			size_t pos = 0;
+			/**@brief Number of filled chunk buffers, starting at @c head.*/
+			size_t count = 0;
+			/**@brief Whether the wrapped source reached the end of input.*/
+			bool done = false;
+			/**@brief Whether the wrapped source reported an error.*/
+			bool failed = false;
+			/**@brief Whether the background thread should stop.*/
+			bool stop = false;
+			/**@brief Guards all of the above except @c source and the
+			 *   contents of chunk buffers.*/
+			std::mutex mutex;
+			/**@brief Signaled when a chunk is filled or the source ends.*/
+			std::condition_variable filled;
+			/**@brief Signaled when a chunk is consumed or on stop.*/
+			std::condition_variable freed;
+			/**@brief Background thread, running @ref run.*/
+			std::thread worker;
+			
+			shared_state(input_source_func_type source_,
+				const size_t chunk_size_, const size_t depth)
+				: source(std::move(source_)), chunk_size(chunk_size_),
+				bufs(depth, std::vector<char>(chunk_size_)), lens(depth, 0) {}
+			~shared_state() {
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					stop = true;
+				}
+				freed.notify_one();
+				if (worker.joinable()) {
+					worker.join();
+				}
+			}
+			/**@brief Body of the background thread.*/
+			void run() {
+				for (size_t tail=0; ; tail=(tail+1)%bufs.size()) {
+					{
+						std::unique_lock<std::mutex> lock(mutex);
+						freed.wait(lock, [this]() {
+							return stop || count < bufs.size(); });
+						if (stop) {
+							return;
+						}
+					}
+					// the tail buffer isn't filled, so it's ours until
+					// count is incremented
+					std::ptrdiff_t nread = source(bufs[tail].data(),
+						chunk_size);
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						if (nread <= 0) {
+							done = true;
+							failed = (nread < 0);
+						}
+						else {
+							lens[tail] = static_cast<size_t>(nread);
+							count++;
+						}
+					}
+					filled.notify_one();
+					if (nread <= 0) {
+						return;
+					}
+				}
+			}
+		};
+		std::shared_ptr<shared_state> state_;
+	public:
+		/**@brief Constructor, which starts the background thread.
+		 * @param source Function reading the next chunk of input.
+		 * @param chunk_size Number of bytes to read per chunk.
+		 * @param depth Number of chunks to read ahead.*/
+		explicit read_ahead_input_source(input_source_func_type source,
+			const size_t chunk_size = 64 * 1024, const size_t depth = 2)
+			: state_(std::make_shared<shared_state>(std::move(source),
+			chunk_size, depth)) {
+			assert(chunk_size > 0 && depth > 0);
+			state_->worker = std::thread(&shared_state::run, state_.get());
+		}
+		/**@brief Copies read-ahead input to @c dest, waiting for the
+		 *   background thread if none is ready.
+		 * @return Number of bytes copied, @c 0 at the end of input, or @c -1
+		 *   if the wrapped source reported an error.*/
+		std::ptrdiff_t operator()(char *dest, const size_t n) {
+			shared_state& s = *state_;
+			std::unique_lock<std::mutex> lock(s.mutex);
+			s.filled.wait(lock, [&s]() { return s.count > 0 || s.done; });
+			if (s.count == 0) {
+				return s.failed ? -1 : 0;
+			}
+			// the head buffer is ours until count is decremented
+			size_t head = s.head;
+			size_t pos = s.pos;
+			size_t k = std::min(n, s.lens[head] - pos);
+			lock.unlock();
+			std::memcpy(dest, s.bufs[head].data() + pos, k);
+			lock.lock();
+			s.pos += k;
+			if (s.pos == s.lens[head]) {
+				s.pos = 0;
+				s.head = (head + 1) % s.bufs.size();
+				s.count--;
+				lock.unlock();
+				s.freed.notify_one();
+			}
+			return static_cast<std::ptrdiff_t>(k);
+		}
+	};
+	
+	
+	
+	/**@brief Feeds a Ragel-generated scanner its input in fixed-size chunks,
+	 *   for input too large to be held in memory all at once.
+	 * @details Each call to @ref refill slides the partially-matched token at
+	 *   <tt>ts..pe</tt> (if any) to the front of the buffer, rebases @c p,
+	 *   @c ts, and @c te to match, and reads the next chunk after it. Tokens
+	 *   are thus never split between chunks, and locations calculated from
+	 *   @c ts and @c te (as by @ref parse_token_trimmed) carry on across
+	 *   refills as if the input were a single buffer. Memory use is bounded by
+	 *   the chunk size plus the length of the longest token.
+	 * 
+	 * The buffer honors the same contract as @ref input_buffer: there is a NUL
+	 * sentinel and @ref INPUT_BUFFER_PADDING zero bytes after @c pe.
+	 * @code{.cpp}
+	 * largemelon::chunked_scanner_input input(
+	 *   largemelon::istream_input_source(std::cin));
+	 * largemelon::ragel_scanner_pers_type rp;
+	 * %% write init;
+	 * do {
+	 *   if (input.refill(rp) != 0) {
+	 *     // handle read error...
+	 *   }
+	 *   %% write exec;
+	 * } while (rp.cs != scanner_error && ! input.at_eof());
+	 * @endcode
+	 * @warning Scanner actions must not keep pointers into the buffer past the
+	 *   end of the token they're matching, since those pointers are
+	 *   invalidated by the next call to @ref refill.*/
+	class chunked_scanner_input {
+		/**@brief Reads the next chunk of input.*/
+		input_source_func_type source_;
+		/**@brief Number of bytes to read per chunk.*/
+		size_t chunk_size_;
+		/**@brief Buffer, allocated by @ref padded_alloc.*/
+		char *buf_;
+		/**@brief Number of input characters that fit in @c buf_.*/
+		size_t capacity_;
+		/**@brief Number of input characters in @c buf_.*/
+		size_t filled_;
+		/**@brief Offset in the whole input of the first character in
+		 *   @c buf_.*/
+		size_t offset_;
+		/**@brief Whether the end of input has been reached.*/
+		bool at_eof_;
+		/**@brief Whether the source reported an error.*/
+		bool failed_;
+	public:
+		/**@brief Constructor.
+		 * @param source Function reading the next chunk of input.
+		 * @param chunk_size Number of bytes to read per chunk.*/
+		explicit chunked_scanner_input(input_source_func_type source,
+			const size_t chunk_size = 64 * 1024) : source_(std::move(source)),
+			chunk_size_(chunk_size), buf_(padded_alloc(chunk_size)),
+			capacity_(chunk_size), filled_(0), offset_(0), at_eof_(false),
+			failed_(false) {
+			assert(chunk_size > 0);
+		}
+		chunked_scanner_input(const chunked_scanner_input&) = delete;
+		chunked_scanner_input& operator=(const chunked_scanner_input&)
+			= delete;
+		/**@brief Destructor.*/
+		~chunked_scanner_input() { padded_free(buf_); }
+		/**@brief Reads the next chunk of input for a scanner, keeping the
+		 *   token it is partway through matching.
+		 * @param rp Scanner registers. @c rp.ts must be @c nullptr if no token
+		 *   is being matched, as after <tt>%% write init;</tt> for a Ragel
+		 *   scanner. Before the first call, @c rp.p and @c rp.pe are ignored;
+		 *   after that, @c rp.p must equal @c rp.pe.
+		 * @return @c 0 on success, nonzero if the source reported an error.
+		 * 
+		 * On success, @c rp.p points at the first new character and @c rp.pe
+		 * just past the last one. At the end of input, no new characters are
+		 * read and @c rp.eof is set to @c rp.pe; otherwise it is set to
+		 * @c nullptr.*/
+		int refill(ragel_scanner_pers_type& rp) {
+			assert(! at_eof_);
+			size_t keep = 0;
+			if (rp.ts != nullptr) {
+				assert(buf_ <= rp.ts && rp.ts <= buf_ + filled_);
+				keep = static_cast<size_t>(buf_ + filled_ - rp.ts);
+			}
+			offset_ += (rp.ts != nullptr)
+				? static_cast<size_t>(rp.ts - buf_)
+				: filled_;
+			
+			// Slide the partial token to the front of the buffer, growing the
+			// buffer if the token and a whole chunk won't both fit.
+			
+			char *dest = buf_;
+			if (keep + chunk_size_ > capacity_) {
+				dest = padded_alloc(keep + chunk_size_);
+			}
+			if (keep > 0) {
+				std::memmove(dest, rp.ts, keep);
+				if (rp.te != nullptr) {
+					rp.te = dest + (rp.te - rp.ts);
+				}
+				rp.ts = dest;
+			}
+			if (dest != buf_) {
+				padded_free(buf_);
+				buf_ = dest;
+				capacity_ = keep + chunk_size_;
+			}
+			
+			// Read the next chunk after it, and re-establish the zero padding
+			// after the end of the input.
+			
+			std::ptrdiff_t nread = source_(buf_ + keep, capacity_ - keep);
+			if (nread < 0) {
+				failed_ = true;
+				nread = 0;
+			}
+			filled_ = keep + static_cast<size_t>(nread);
+			rp.p = buf_ + keep;
+			rp.pe = buf_ + filled_;
+			std::memset(buf_ + keep + nread, 0, INPUT_BUFFER_PADDING + 1);
+			if (nread == 0) {
+				at_eof_ = true;
+				rp.eof = rp.pe;
+			}
+			else {
+				rp.eof = nullptr;
+			}
+			return failed_ ? 1 : 0;
+		}
+		/**@brief Whether the end of input has been reached, in which case
+		 *   @ref refill must not be called again.*/
+		bool at_eof() const { return at_eof_; }
+		/**@brief Offset in the whole input of a character in the buffer.
+		 * @param p Pointer to character in the buffer, such as @c rp.ts.*/
+		size_t offset_of(const char *p) const {
+			assert(buf_ <= p && p <= buf_ + capacity_);
+			return offset_ + static_cast<size_t>(p - buf_);
+		}
+		/**@brief Number of input characters that fit in the buffer, which is
+		 *   the chunk size plus the length of the longest token so far.*/
+		size_t capacity() const { return capacity_; }
+	};
+	
+	
+	
+	/**@brief Runs tasks on a pool of threads, each of which takes tasks from
+	 *   the front of its own queue and, once that runs dry, steals them from
+	 *   the backs of the other threads' queues.
+	 * @param queues Initial queue of task indices for each thread. The
+	 *   calling thread runs the first queue, so <tt>queues.size() - 1</tt>
+	 *   threads are started.
+	 * @param func Function called with the index of the thread (that is, of
+	 *   its queue) and the index of the task. Calls with the same thread index
+	 *   are never concurrent.
+	 * 
+	 * Tasks must not add tasks of their own; a thread exits as soon as it
+	 * finds every queue empty. This returns once every task has run.*/
+	inline void run_work_stealing(std::vector<std::deque<size_t>> queues,
+		const std::function<void(size_t, size_t)>& func) {
+		size_t nthreads = queues.size();
+		std::vector<std::mutex> mutexes(nthreads);
+		auto next_task = [&](const size_t w, size_t& task) {
+			{
+				std::lock_guard<std::mutex> lock(mutexes[w]);
+				if (! queues[w].empty()) {
+					task = queues[w].front();
+					queues[w].pop_front();
+					return true;
+				}
+			}
+			for (size_t i=1; i<nthreads; i++) {
+				size_t v = (w + i) % nthreads;
+				std::lock_guard<std::mutex> lock(mutexes[v]);
+				if (! queues[v].empty()) {
+					task = queues[v].back();
+					queues[v].pop_back();
+					return true;
+				}
+			}
+			return false;
+		};
+		auto work = [&](const size_t w) {
+			size_t task;
+			while (next_task(w, task)) {
+				func(w, task);
+			}
+		};
+		
+		std::vector<std::thread> threads;
+		for (size_t w=1; w<nthreads; w++) {
+			threads.emplace_back(work, w);
+		}
+		if (nthreads > 0) {
+			work(0);
+		}
+		for (std::thread& t: threads) {
+			t.join();
+		}
+	}
+	
+	
+	
+	/**@brief Outcome of parsing one of the files passed to
+	 *   @ref parse_files.
+	 * @tparam ContextType Data type for the context object passed by pointer
+	 *   between calls to the parser.*/
+	template <typename ContextType>
+	struct file_parse_result {
+		/**@brief Path to parsed file.*/
+		std::filesystem::path fpath;
+		/**@brief Parsing context, holding whatever the parser built for this
+		 *   file, such as its AST and diagnostics.*/
+		ContextType context;
+		/**@brief Value returned by the parse function, @c 0 on success.*/
+		int status = 0;
+	};
+	
+	/**@brief Data type for a function that scans and parses one file.
+	 * @details The function is called with a fresh parsing context, an
+	 *   allocated Lemon parser, and the path to the file to be parsed. It
+	 *   returns @c 0 on success, nonzero otherwise.
+	 * @tparam ContextType Data type for the context object passed by pointer
+	 *   between calls to the parser.*/
+	template <typename ContextType>
+	using file_parse_func_type = std::function<int(ContextType&, void *,
+		const std::filesystem::path&)>;
+	
+	/**@brief Options for @ref parse_files.*/
+	struct parse_files_options {
+		/**@brief Number of threads, or @c 0 to use one per core.*/
+		size_t nthreads = 0;
+		/**@brief Largest estimated cost, in bytes, of a batch of small files
+		 *   parsed as a single task. Files costing at least this much are
+		 *   tasks of their own.*/
+		uintmax_t batch_bytes = 256 * 1024;
+		/**@brief Estimated cost, in bytes, of opening and setting up a file
+		 *   for parsing, added to its size.*/
+		uintmax_t file_overhead_bytes = 4096;
+		/**@brief <tt>ParseInit()</tt>-like function, or empty. If this and
+		 *   @ref parsefinalize are given, each thread's parser is reset
+		 *   between files (see @ref lemon_parser_pool).*/
+		lemon_parseinit_func_type parseinit;
+		/**@brief <tt>ParseFinalize()</tt>-like function, or empty.*/
+		lemon_parsefinalize_func_type parsefinalize;
+	};
+	
+	/**@brief Scheduling statistics from @ref parse_files, for tuning
+	 *   @ref parse_files_options.*/
+	struct parse_files_stats {
+		/**@brief Number of files.*/
+		size_t nfiles = 0;
+		/**@brief Number of tasks after small files were batched.*/
+		size_t ntasks = 0;
+		/**@brief Number of threads.*/
+		size_t nthreads = 0;
+		/**@brief Total estimated cost of all files, in bytes.*/
+		uintmax_t total_bytes = 0;
+		/**@brief Estimated cost of the most heavily loaded thread, in
+		 *   bytes.*/
+		uintmax_t max_load_bytes = 0;
+		/**@brief Time the most heavily loaded thread was estimated to take,
+		 *   at the throughput measured over all threads, in seconds.*/
+		double estimated_makespan = 0.0;
+		/**@brief Time from the first task starting to the last one finishing,
+		 *   in seconds.*/
+		double actual_makespan = 0.0;
+	};
+	
+	/**@brief Output stream operator for @c parse_files_stats.
+	 * @param os Output stream.
+	 * @param stats Scheduling statistics.
+	 * @return Output stream.*/
+	inline std::ostream& operator<<(std::ostream& os,
+		const parse_files_stats& stats) {
+		os << stats.nfiles << " files in " << stats.ntasks << " tasks on "
+			<< stats.nthreads << " threads, makespan "
+			<< stats.actual_makespan << " s (estimated "
+			<< stats.estimated_makespan << " s)";
+		return os;
+	}
+	
+	/**@brief Plan for spreading files over the threads of
+	 *   @ref run_work_stealing.*/
+	struct file_task_plan {
+		/**@brief Indices of the files making up each task.*/
+		std::vector<std::vector<size_t>> tasks;
+		/**@brief Initial queue of task indices for each thread, most costly
+		 *   first.*/
+		std::vector<std::deque<size_t>> queues;
+		/**@brief Estimated cost of the tasks queued for each thread, in
+		 *   bytes.*/
+		std::vector<uintmax_t> loads;
+	};
+	
+	/**@brief Plans the tasks for parsing files of the given sizes,
+	 *   longest-processing-time first.
+	 * @param sizes Size of each file, in bytes.
+	 * @param nthreads Number of threads, at least @c 1.
+	 * @param batch_bytes See @ref parse_files_options::batch_bytes.
+	 * @param file_overhead_bytes See
+	 *   @ref parse_files_options::file_overhead_bytes.
+	 * @return Plan for the tasks.
+	 * 
+	 * Files are sorted by estimated cost, largest first. Large files become
+	 * tasks of their own, and runs of small files are batched into tasks
+	 * costing up to @c batch_bytes. Each task, largest first, then goes to the
+	 * thread with the least estimated load so far. With each thread working
+	 * through its queue largest first, and stealing the smallest tasks left
+	 * in the others' queues, no thread is left with a large file at the
+	 * end.*/
+	inline file_task_plan plan_file_tasks(const std::vector<uintmax_t>& sizes,
+		const size_t nthreads, const uintmax_t batch_bytes,
+		const uintmax_t file_overhead_bytes) {
+		assert(nthreads > 0);
+		file_task_plan plan;
+		auto cost = [&](const size_t i) {
+			return sizes[i] + file_overhead_bytes;
+		};
+		std::vector<size_t> order(sizes.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(),
+			[&](const size_t a, const size_t b) { return cost(a) > cost(b); });
+		
+		// Batch small files, which are all at the end of the order.
+		
+		std::vector<uintmax_t> task_costs;
+		for (size_t i: order) {
+			if (task_costs.empty() || cost(i) >= batch_bytes
+				|| task_costs.back() >= batch_bytes
+				|| task_costs.back() + cost(i) > batch_bytes) {
+				plan.tasks.emplace_back();
+				task_costs.push_back(0);
+			}
+			plan.tasks.back().push_back(i);
+			task_costs.back() += cost(i);
+		}
+		
+		// Greedily assign tasks to the least-loaded thread, largest first.
+		
+		std::vector<size_t> task_order(plan.tasks.size());
+		std::iota(task_order.begin(), task_order.end(), 0);
+		std::stable_sort(task_order.begin(), task_order.end(),
+			[&](const size_t a, const size_t b) {
+				return task_costs[a] > task_costs[b]; });
+		plan.queues.resize(nthreads);
+		plan.loads.assign(nthreads, 0);
+		for (size_t t: task_order) {
+			size_t w = static_cast<size_t>(std::min_element(
+				plan.loads.begin(), plan.loads.end()) - plan.loads.begin());
+			plan.queues[w].push_back(t);
+			plan.loads[w] += task_costs[t];
+		}
+		return plan;
+	}
+	
+	/**@brief Parses many files at once, spread over a work-stealing pool of
+	 *   threads (see @ref run_work_stealing) and scheduled by
+	 *   @ref plan_file_tasks.
+	 * @tparam ContextType Data type for the context object passed by pointer
+	 *   between calls to the parser. It must be default-constructible and
+	 *   movable, and a new one is constructed for every file.
+	 * @param results Outcome for each file, in the same order as @c fpaths
+	 *   whatever order the files were parsed in.
+	 * @param stats Scheduling statistics.
+	 * @param fpaths Paths to files to be parsed. Their sizes are looked up
+	 *   first, for scheduling; a file whose size can't be looked up is
+	 *   scheduled as if it were empty.
+	 * @param parsealloc <tt>ParseAlloc()</tt>-like function, called once per
+	 *   thread.
+	 * @param parsefree <tt>ParseFree()</tt>-like function.
+	 * @param parse_file Function scanning and parsing one file. It is called
+	 *   concurrently from several threads, with a parser only used by the
+	 *   calling thread.
+	 * @param options Scheduling options.
+	 * @return Number of files for which @c parse_file returned nonzero, so
+	 *   @c 0 on success.
+	 * 
+	 * Each thread reuses its parser from file to file, through a
+	 * @ref lemon_parser_pool of its own. If
+	 * @ref parse_files_options::parseinit and
+	 * @ref parse_files_options::parsefinalize are given, the parser is reset
+	 * after every file, however its parse ended. Otherwise, @c parse_file
+	 * must pass the end-of-input token (@c 0) to the parser on success, which
+	 * returns a Lemon-generated parser to its initial state, and the parser
+	 * of a file for which it returns nonzero is freed rather than reused.
+	 * @code{.cpp}
+	 * std::vector<largemelon::file_parse_result<context>> results;
+	 * largemelon::parse_files_stats stats;
+	 * int nfailed = largemelon::parse_files<context>(results, stats, fpaths,
+	 *   ParseAlloc, ParseFree,
+	 *   [](context& ctx, void *pparser, const std::filesystem::path& fpath) {
+	 *     largemelon::input_buffer input;
+	 *     if (input.map_file(fpath) != 0) {
+	 *       return 1;
+	 *     }
+	 *     return scan_and_parse(ctx, pparser, input, fpath);
+	 *   }, largemelon::parse_files_options());
+	 * std::cerr << stats << std::endl;
+	 * for (auto& r: results) {
+	 *   // merge r.context into the whole program...
+	 * }
+	 * @endcode*/
+	template <typename ContextType>
+	inline int parse_files(std::vector<file_parse_result<ContextType>>& results,
+		parse_files_stats& stats,
+		const std::vector<std::filesystem::path>& fpaths,
+		lemon_parsealloc_func_type parsealloc,
+		lemon_parsefree_func_type parsefree,
+		file_parse_func_type<ContextType> parse_file,
+		const parse_files_options& options) {
+		
+		using clock = std::chrono::steady_clock;
+		size_t nthreads = options.nthreads;
+		if (nthreads == 0) {
+			nthreads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		nthreads = std::max<size_t>(1, std::min(nthreads, fpaths.size()));
+		results.clear();
+		results.resize(fpaths.size());
+		
+		std::vector<uintmax_t> sizes(fpaths.size());
+		for (size_t i=0; i<fpaths.size(); i++) {
+			std::error_code ec;
+			sizes[i] = std::filesystem::file_size(fpaths[i], ec);
+			if (ec) {
+				sizes[i] = 0;
+			}
+		}
+		file_task_plan plan = plan_file_tasks(sizes, nthreads,
+			options.batch_bytes, options.file_overhead_bytes);
+		stats = parse_files_stats();
+		stats.nfiles = fpaths.size();
+		stats.ntasks = plan.tasks.size();
+		stats.nthreads = nthreads;
+		stats.total_bytes = std::accumulate(plan.loads.begin(),
+			plan.loads.end(), uintmax_t(0));
+		stats.max_load_bytes = plan.loads.empty() ? 0
+			: *std::max_element(plan.loads.begin(), plan.loads.end());
+		
+		std::vector<lemon_parser_pool> pools;
+		for (size_t w=0; w<nthreads; w++) {
+			pools.emplace_back(parsealloc, parsefree, options.parseinit,
+				options.parsefinalize);
+		}
+		std::vector<double> busy(nthreads, 0.0);
+		auto t0 = clock::now();
+		run_work_stealing(std::move(plan.queues),
+			[&](const size_t w, const size_t t) {
+				auto t1 = clock::now();
+				for (size_t i: plan.tasks[t]) {
+					lemon_parser_pool::lease parser(pools[w]);
+					results[i].fpath = fpaths[i];
+					results[i].status = parse_file(results[i].context,
+						parser.get(), fpaths[i]);
+					if (results[i].status != 0) {
+						parser.fail();
+					}
+				}
+				busy[w] += std::chrono::duration<double>(
+					clock::now() - t1).count();
+			});
+		stats.actual_makespan = std::chrono::duration<double>(
+			clock::now() - t0).count();
+		pools.clear();
+		
+		double total_busy = std::accumulate(busy.begin(), busy.end(), 0.0);
+		if (stats.total_bytes > 0) {
+			stats.estimated_makespan = total_busy
+				* stats.max_load_bytes / stats.total_bytes;
+		}
+		return static_cast<int>(std::count_if(results.begin(),
+			results.end(), [](const file_parse_result<ContextType>& r) {
+				return r.status != 0; }));
+	}
+	
+	/**@brief Parses many files at once with the default scheduling options,
+	 *   discarding scheduling statistics.
+	 * @param nthreads Number of threads, or @c 0 to use one per core.
+	 * @see The other overload of this function for the other parameters.*/
+	template <typename ContextType>
+	inline int parse_files(std::vector<file_parse_result<ContextType>>& results,
+		const std::vector<std::filesystem::path>& fpaths,
+		lemon_parsealloc_func_type parsealloc,
+		lemon_parsefree_func_type parsefree,
+		file_parse_func_type<ContextType> parse_file, size_t nthreads = 0) {
+		parse_files_stats stats;
+		parse_files_options options;
+		options.nthreads = nthreads;
+		return parse_files<ContextType>(results, stats, fpaths,
+			std::move(parsealloc), std::move(parsefree), std::move(parse_file),
+			options);
+	}
+	
+	
+	
+	/**@brief Data type for a function that runs a Ragel-generated scanner
+	 *   over a chunk of text for @ref speculative_lex.
+	 * @details The function is called with the scanner registers already set
+	 *   up for the chunk: @c rp.cs is the state to start in, @c rp.p and
+	 *   @c rp.pe span the chunk, @c rp.eof equals @c rp.pe, and @c rp.ts and
+	 *   @c rp.te are @c nullptr. It runs <tt>%% write exec;</tt> (but not
+	 *   <tt>%% write init;</tt>), appends the tokens it matched to the given
+	 *   vector, and returns @c 0 on success or nonzero if the scanner failed,
+	 *   leaving the state it ended in in @c rp.cs.
+	 * @tparam TokenType Data type for matched tokens. To be located
+	 *   afterward, they should record their offsets in the whole text.*/
+	template <typename TokenType>
+	using chunk_lex_func_type = std::function<int(ragel_scanner_pers_type&,
+		std::vector<TokenType>&)>;
+	
+	/**@brief Scans a large text on several threads at once, by speculatively
+	 *   scanning chunks of it from the scanner's start state and then fixing up
+	 *   the chunks whose start state was guessed wrong.
+	 * @tparam TokenType Data type for matched tokens.
+	 * @param tokens Matched tokens, in the same order as if the whole text had
+	 *   been scanned in one go.
+	 * @param lines Line index of the text, for locating tokens afterward.
+	 * @param data Pointer to first character of text.
+	 * @param size Number of characters in text.
+	 * @param start_cs Start state of the scanner, such as
+	 *   @c scanner_start for a machine named @c scanner.
+	 * @param lex Function running the scanner over a chunk. It is called
+	 *   concurrently from several threads.
+	 * @param nthreads Number of threads, or @c 0 to use one per core.
+	 * @param min_chunk_size Smallest chunk worth scanning on a thread of its
+	 *   own, in characters.
+	 * @return @c 0 on success, or the nonzero value returned by @c lex for the
+	 *   first chunk the scanner failed on, even after being scanned again
+	 *   with the chunks after it. Only the tokens up to the end of that chunk
+	 *   are kept, as a serial scan stops at its first failure.
+	 * 
+	 * The text is cut just after newlines into one chunk per thread, and each
+	 * chunk is scanned from @c start_cs with its end treated as the end of
+	 * input. The line index is built at the same time. Then, from first to
+	 * last, each seam between chunks is checked: the state the previous chunk
+	 * ended in must be the state the next one started in. If it isn't, the
+	 * next chunk is scanned again from the right state; if the previous chunk
+	 * failed, as when a token runs on past its end, the two are scanned again
+	 * as one. The result is only exact if every token that can run on past a
+	 * newline does so in a state other than @c start_cs, as a comment
+	 * machine entered with @c fgoto does, or fails at the end of input, as a
+	 * quoted string without its closing quote does. A run of whitespace that
+	 * includes newlines may otherwise be split at a seam.*/
+	template <typename TokenType>
+	inline int speculative_lex(std::vector<TokenType>& tokens,
+		line_index& lines, const char *data, const size_t size,
+		const int start_cs, chunk_lex_func_type<TokenType> lex,
+		size_t nthreads = 0, const size_t min_chunk_size = 1 << 20) {
+		
+		// chunk of text, scanned from a given state
+		struct chunk {
+			size_t begin, end;
+			int start_cs, end_cs;
+			int status;
+			std::vector<TokenType> tokens;
+			std::vector<size_t> line_starts;
+		};
+		auto scan = [&](chunk& c) {
+			ragel_scanner_pers_type rp;
+			rp.cs = c.start_cs;
+			rp.act = 0;
+			rp.p = data + c.begin;
+			rp.pe = data + c.end;
+			rp.eof = rp.pe;
+			rp.ts = rp.te = nullptr;
+			c.tokens.clear();
+			c.status = lex(rp, c.tokens);
+			c.end_cs = rp.cs;
+		};
+		
+		// Cut the text just after the first newline at or after each even
+		// split.
+		
+		if (nthreads == 0) {
+			nthreads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		nthreads = std::max<size_t>(1, std::min(nthreads,
+			size / std::max<size_t>(1, min_chunk_size)));
+		std::vector<chunk> chunks;
+		size_t begin = 0;
+		for (size_t i=1; i<=nthreads && (begin<size || chunks.empty()); i++) {
+			size_t end = size;
+			if (i < nthreads) {
+				size_t split = std::max(begin, i * size / nthreads);
+				const void *nl = std::memchr(data + split, '\n', size - split);
+				if (nl != nullptr) {
+					end = static_cast<size_t>(
+						static_cast<const char *>(nl) - data) + 1;
+				}
+			}
+			chunks.push_back({ begin, end, start_cs, start_cs, 0, {}, {} });
+			begin = end;
+		}
+		
+		std::vector<std::deque<size_t>> queues(chunks.size());
+		for (size_t i=0; i<chunks.size(); i++) {
+			queues[i].push_back(i);
+		}
+		run_work_stealing(std::move(queues), [&](size_t, const size_t i) {
+			find_line_starts(chunks[i].line_starts, data + chunks[i].begin,
+				data + chunks[i].end, chunks[i].begin);
+			scan(chunks[i]);
+		});
+		
+		// Check the seams in order, rescanning where the guess was wrong, and
+		// stitch the results together.
+		
+		std::vector<size_t> line_starts = { 0 };
+		for (size_t i=0; i<chunks.size(); i++) {
+			line_starts.insert(line_starts.end(),
+				chunks[i].line_starts.begin(), chunks[i].line_starts.end());
+		}
+		lines = line_index(std::move(line_starts));
+		std::vector<size_t> kept = { 0 };
+		for (size_t i=1; i<chunks.size(); i++) {
+			chunk& last = chunks[kept.back()];
+			if (last.status != 0) {
+				// maybe a token was cut off by the end of the last chunk, so
+				// scan the two as one from the last chunk's own start state,
+				// and check the merged chunk's seam with the next one after
+				last.end = chunks[i].end;
+				scan(last);
+				continue;
+			}
+			if (chunks[i].start_cs != last.end_cs) {
+				chunks[i].start_cs = last.end_cs;
+				scan(chunks[i]);
+			}
+			kept.push_back(i);
+		}
+		tokens.clear();
+		int status = 0;
+		for (size_t i: kept) {
+			std::move(chunks[i].tokens.begin(), chunks[i].tokens.end(),
+				std::back_inserter(tokens));
+			if (chunks[i].status != 0) {
+				status = chunks[i].status;
+				break;
+			}
+		}
+		
+		return status;
+	}
+	
+	
+	
+	/**@brief Text and tokens changed by @ref incremental_lexer::relex.*/
+	struct relex_span {
+		/**@brief Offset of first character scanned again, after the edit.*/
+		size_t begin;
+		/**@brief Offset just after last character scanned again, after the
+		 *   edit.*/
+		size_t end;
+		/**@brief Index of first token that changed.*/
+		size_t first_token;
+		/**@brief Number of tokens removed at @c first_token.*/
+		size_t nremoved;
+		/**@brief Number of tokens inserted at @c first_token in their place.*/
+		size_t ninserted;
+		/**@brief Shift in locations after the edit.*/
+		text_loc_delta delta;
+	};
+	
+	/**@brief Data type for a function that shifts whatever locations a token
+	 *   records, other than its offsets, past an edit (see
+	 *   @ref shift_text_loc).*/
+	template <typename TokenType>
+	using token_shift_func_type = std::function<void(TokenType&,
+		const text_loc_delta&)>;
+	
+	/**@brief Tokens of a text, kept up to date as the text is edited by
+	 *   scanning again only the text around each edit.
+	 * @tparam TokenType Data type for matched tokens. It must have @c begin
+	 *   and @c end data members, for the offsets of the first character of
+	 *   the token and of just after its last, and be comparable with
+	 *   <tt>==</tt>.
+	 *
+	 * The text is scanned in chunks cut just after newlines, as by
+	 * @ref speculative_lex but one after another, and the state the scanner
+	 * ends each chunk in is kept. After an edit, scanning starts over at the
+	 * chunk the edit starts in, from the state it started in, and goes on
+	 * past the edit until a chunk ends in the same state, and at the same
+	 * position, as it did before. The tokens after that are kept, with their
+	 * offsets and locations shifted, and so is the rest of the chunk
+	 * table. The same caveat as for @ref speculative_lex applies to tokens
+	 * that run on past a newline in the scanner's start state.*/
+	template <typename TokenType>
+	class incremental_lexer {
+		/**@brief Chunk of text, scanned from a given state.*/
+		struct chunk {
+			size_t begin, end;
+			int start_cs, end_cs;
+			int status;
+			/**@brief Index of first token matched in this chunk.*/
+			size_t first_token;
+		};
+		/**@brief Start state of the scanner.*/
+		int start_cs_;
+		/**@brief Function running the scanner over a chunk.*/
+		chunk_lex_func_type<TokenType> lex_;
+		/**@brief Function shifting the locations recorded by a token.*/
+		token_shift_func_type<TokenType> shift_;
+		/**@brief Smallest number of characters in a chunk.*/
+		size_t chunk_size_;
+		/**@brief Number of characters in text.*/
+		size_t size_;
+		/**@brief Chunks, in order, spanning the whole text.*/
+		std::vector<chunk> chunks_;
+		/**@brief Matched tokens, in order.*/
+		std::vector<TokenType> tokens_;
+		/**@brief Line index of the text.*/
+		line_index lines_;
+		/**@brief What changed in the last call to @ref relex.*/
+		relex_span last_;
+		/**@brief Offset just after the first newline at or after an offset,
+		 *   but no further than a limit.*/
+		static size_t cut(const char *data, const size_t from,
+			const size_t limit) {
+			if (from >= limit) {
+				return limit;
+			}
+			const void *nl = std::memchr(data + from, '\n', limit - from);
+			return (nl == nullptr) ? limit : static_cast<size_t>(
+				static_cast<const char *>(nl) - data) + 1;
+		}
+	public:
+		/**@brief Constructor.
+		 * @param start_cs Start state of the scanner, such as
+		 *   @c scanner_start for a machine named @c scanner.
+		 * @param lex Function running the scanner over a chunk, as for
+		 *   @ref speculative_lex. It should record token offsets against the
+		 *   text last passed to @ref lex or @ref relex, and may locate them
+		 *   with @ref lines, which is already up to date for that text.
+		 * @param shift Function shifting the locations recorded by a token,
+		 *   or @c nullptr if it records only its offsets.
+		 * @param chunk_size Smallest number of characters in a chunk. Smaller
+		 *   chunks mean less text scanned after each edit, and more states
+		 *   kept.*/
+		incremental_lexer(const int start_cs,
+			chunk_lex_func_type<TokenType> lex,
+			token_shift_func_type<TokenType> shift = nullptr,
+			const size_t chunk_size = 4096) : start_cs_(start_cs),
+			lex_(std::move(lex)), shift_(std::move(shift)),
+			chunk_size_(chunk_size), size_(0),
+			chunks_{ { 0, 0, start_cs, start_cs, 0, 0 } }, tokens_(), lines_(),
+			last_() {
+			assert(lex_);
+		}
+		/**@brief Scans a whole text.
+		 * @param data Pointer to first character of text.
+		 * @param size Number of characters in text.
+		 * @return @c 0 on success, or the nonzero value returned by the scan
+		 *   function for the last chunk if the scanner failed.*/
+		int lex(const char *data, const size_t size) {
+			size_ = 0;
+			chunks_ = { { 0, 0, start_cs_, start_cs_, 0, 0 } };
+			tokens_.clear();
+			lines_ = line_index();
+			return relex(data, size, text_edit{ 0, 0, size });
+		}
+		/**@brief Scans again the text around an edit.
+		 * @param data Pointer to first character of text, after the edit.
+		 * @param size Number of characters in text, after the edit.
+		 * @param edit Edit made to the text since it was last scanned.
+		 * @return Same as for @ref lex.
+		 * @details What changed is given by @ref last_relex afterward.*/
+		int relex(const char *data, const size_t size, const text_edit& edit) {
+			const size_t old_end = edit.offset + edit.old_size;
+			const size_t new_end = edit.offset + edit.new_size;
+			assert(old_end <= size_);
+			assert(size == size_ - edit.old_size + edit.new_size);
+			last_.delta = lines_.apply_edit(data, size, edit);
+			auto shifted = [&edit](const size_t offset) {
+				return offset - edit.old_size + edit.new_size;
+			};
+			auto chunk_at = [this](const size_t offset) {
+				return static_cast<size_t>(std::upper_bound(chunks_.begin(),
+					chunks_.end(), offset, [](const size_t o, const chunk& c) {
+						return o < c.begin; }) - chunks_.begin()) - 1;
+			};
+			
+			// Scan from the chunk the edit starts in until a chunk ends where
+			// an old one did, in the same state, past the edit (and so just
+			// after a newline that wasn't replaced). A chunk that fails is
+			// scanned again with the text after it, in case a token was cut
+			// off by its end.
+			
+			const size_t i = chunk_at(edit.offset);
+			size_t j = chunk_at(old_end);
+			size_t limit = shifted(chunks_[j].end);
+			std::vector<chunk> fresh;
+			std::vector<TokenType> tokens;
+			size_t pos = chunks_[i].begin;
+			int cs = chunks_[i].start_cs;
+			for (;;) {
+				chunk c = { pos, cut(data, pos + chunk_size_, limit), cs, cs, 0,
+					tokens.size() };
+				for (;;) {
+					tokens.erase(tokens.begin() + c.first_token, tokens.end());
+					ragel_scanner_pers_type rp;
+					rp.cs = c.start_cs;
+					rp.act = 0;
+					rp.p = data + c.begin;
+					rp.pe = data + c.end;
+					rp.eof = rp.pe;
+					rp.ts = rp.te = nullptr;
+					c.status = lex_(rp, tokens);
+					c.end_cs = rp.cs;
+					if (c.status == 0 || c.end == size) {
+						break;
+					}
+					if (c.end == limit) {
+						limit = shifted(chunks_[++j].end);
+					}
+					c.end = cut(data, c.end + chunk_size_, limit);
+				}
+				if (c.end > c.begin || c.status != 0
+					|| tokens.size() > c.first_token) {
+					fresh.push_back(c);
+				}
+				pos = c.end;
+				cs = c.end_cs;
+				if (pos == size) {
+					j = chunks_.size() - 1;
+					break;
+				}
+				if (pos == limit) {
+					if (c.status == 0 && cs == chunks_[j].end_cs) {
+						break;
+					}
+					limit = shifted(chunks_[++j].end);
+				}
+			}
+			
+			// Report the tokens that changed, leaving out those before the
+			// edit, or after it, that were matched again as they were.
+			
+			const size_t first = chunks_[i].first_token;
+			const size_t last = (j + 1 < chunks_.size())
+				? chunks_[j + 1].first_token : tokens_.size();
+			auto shift_token = [&](TokenType& t) {
+				t.begin = shifted(t.begin);
+				t.end = shifted(t.end);
+				if (shift_) {
+					shift_(t, last_.delta);
+				}
+			};
+			size_t nprefix = 0;
+			while (first + nprefix < last && nprefix < tokens.size()
+				&& tokens_[first + nprefix].end <= edit.offset
+				&& tokens_[first + nprefix] == tokens[nprefix]) {
+				nprefix++;
+			}
+			size_t nsuffix = 0;
+			while (first + nprefix + nsuffix < last
+				&& nprefix + nsuffix < tokens.size()) {
+				TokenType t = tokens_[last - 1 - nsuffix];
+				const TokenType& u = tokens[tokens.size() - 1 - nsuffix];
+				if (t.begin < old_end || u.begin < new_end) {
+					break;
+				}
+				shift_token(t);
+				if (! (t == u)) {
+					break;
+				}
+				nsuffix++;
+			}
+			last_.begin = chunks_[i].begin;
+			last_.end = pos;
+			last_.first_token = first + nprefix;
+			last_.nremoved = last - first - nprefix - nsuffix;
+			last_.ninserted = tokens.size() - nprefix - nsuffix;
+			
+			// Put the new chunks and tokens in place of the old ones, and
+			// shift the rest.
+			
+			for (size_t k=j+1; k<chunks_.size(); k++) {
+				chunks_[k].begin = shifted(chunks_[k].begin);
+				chunks_[k].end = shifted(chunks_[k].end);
+				chunks_[k].first_token = chunks_[k].first_token - (last - first)
+					+ tokens.size();
+			}
+			for (size_t k=last; k<tokens_.size(); k++) {
+				shift_token(tokens_[k]);
+			}
+			for (chunk& c: fresh) {
+				c.first_token += first;
+			}
+			tokens_.erase(tokens_.begin() + first, tokens_.begin() + last);
+			tokens_.insert(tokens_.begin() + first,
+				std::make_move_iterator(tokens.begin()),
+				std::make_move_iterator(tokens.end()));
+			chunks_.erase(chunks_.begin() + i, chunks_.begin() + j + 1);
+			chunks_.insert(chunks_.begin() + i, fresh.begin(), fresh.end());
+			if (chunks_.empty()) {
+				chunks_.push_back({ 0, 0, start_cs_, start_cs_, 0, 0 });
+			}
+			size_ = size;
+			
+			return chunks_.back().status;
+		}
+		/**@brief Matched tokens, in order.*/
+		const std::vector<TokenType>& tokens() const { return tokens_; }
+		/**@brief Line index of the text.*/
+		const line_index& lines() const { return lines_; }
+		/**@brief What changed in the last call to @ref relex (or @ref lex).*/
+		const relex_span& last_relex() const { return last_; }
+	};
+	
+	
+	
+	/**@brief Splits a text into regions that start at top-level constructs,
+	 *   for @ref parse_regions.
+	 * @param data Pointer to first character of text.
+	 * @param size Number of characters in text.
+	 * @param nregions Largest number of regions to split the text into.
+	 * @return Offsets at which the regions start, followed by @c size.
+	 * 
+	 * A top-level construct is taken to start at a line with zero indent,
+	 * that is, one starting with a character other than whitespace: a line at
+	 * which @ref update_block_indents would close every open block, or at
+	 * which a declaration list in a free-form language typically goes on to
+	 * its next declaration. Each region starts at the first such line at or
+	 * after an even split of the text, so regions are roughly equal in size.*/
+	inline std::vector<size_t> split_top_level_regions(const char *data,
+		const size_t size, const size_t nregions) {
+		auto is_indent = [](const char c) {
+			return c == ' ' || c == '\t' || c == '\r' || c == '\n'
+				|| c == '\f' || c == '\v';
+		};
+		std::vector<size_t> cuts = { 0 };
+		for (size_t i=1; i<nregions; i++) {
+			size_t pos = std::max(cuts.back(), i * size / nregions);
+			while (pos < size) {
+				const void *nl = std::memchr(data + pos, '\n', size - pos);
+				if (nl == nullptr) {
+					pos = size;
+					break;
+				}
+				pos = static_cast<size_t>(
+					static_cast<const char *>(nl) - data) + 1;
+				if (pos < size && ! is_indent(data[pos])) {
+					break;
+				}
+			}
+			if (pos >= size) {
+				break;
+			}
+			cuts.push_back(pos);
+		}
+		cuts.push_back(size);
+		return cuts;
+	}
+	
+	/**@brief Data type for a function that scans and parses one region of a
+	 *   text as if it were a whole text.
+	 * @details The function is called with a fresh parsing context, a newly
+	 *   allocated Lemon parser, pointers to the first character of the region
+	 *   and just after its last, and the location of the text just before the
+	 *   region (to start location tracking from, as @ref FIRST_TEXT_LOC is for
+	 *   a whole text). It passes the end-of-input token (@c 0) to the parser
+	 *   at the end of the region, and returns @c 0 on success, nonzero
+	 *   otherwise.
+	 * @tparam ContextType Data type for the context object passed by pointer
+	 *   between calls to the parser.*/
+	template <typename ContextType>
+	using region_parse_func_type = std::function<int(ContextType&, void *,
+		const char *, const char *, const text_loc&)>;
+	
+	/**@brief Data type for a function that grafts what was parsed from one
+	 *   region of a text onto what was parsed from the regions before it,
+	 *   such as by moving the top-level nodes of the region's AST under the
+	 *   whole text's root node (see @ref ast_base_type::graft_childs).
+	 * @tparam ContextType Data type for the context object passed by pointer
+	 *   between calls to the parser.*/
+	template <typename ContextType>
+	using region_graft_func_type = std::function<void(ContextType&,
+		ContextType&)>;
+	
+	/**@brief Parses a large text on several threads at once, by splitting it
+	 *   into regions of independent top-level constructs (see
+	 *   @ref split_top_level_regions) and parsing each region with a parser
+	 *   of its own.
+	 * @tparam ContextType Data type for the context object passed by pointer
+	 *   between calls to the parser. It must be default-constructible.
+	 * @param context Parsing context for the whole text, onto which each
+	 *   region's context is grafted in order.
+	 * @param data Pointer to first character of text.
+	 * @param size Number of characters in text.
+	 * @param parsealloc <tt>ParseAlloc()</tt>-like function, called once per
+	 *   region.
+	 * @param parsefree <tt>ParseFree()</tt>-like function.
+	 * @param parse_region Function scanning and parsing one region. It is
+	 *   called concurrently from several threads.
+	 * @param graft Function grafting a region's context onto @c context. It
+	 *   is only called from the calling thread, in the order of the regions.
+	 * @param nthreads Number of threads, or @c 0 to use one per core.
+	 * @param min_region_size Smallest region worth parsing on a thread of its
+	 *   own, in characters.
+	 * @return @c 0 on success, or the value returned by @c parse_region for
+	 *   the whole text otherwise.
+	 * 
+	 * If parsing any region fails, as it does when a region starts partway
+	 * through a construct after all, then the regions' contexts are thrown
+	 * away and the whole text is parsed again in one go, on the calling
+	 * thread, into @c context. So the result, including any diagnostics, is
+	 * always the same as for a serial parse.*/
+	template <typename ContextType>
+	inline int parse_regions(ContextType& context, const char *data,
+		const size_t size, lemon_parsealloc_func_type parsealloc,
+		lemon_parsefree_func_type parsefree,
+		region_parse_func_type<ContextType> parse_region,
+		region_graft_func_type<ContextType> graft, size_t nthreads = 0,
+		const size_t min_region_size = 64 * 1024) {
+		
+		if (nthreads == 0) {
+			nthreads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		nthreads = std::max<size_t>(1, std::min(nthreads,
+			size / std::max<size_t>(1, min_region_size)));
+		std::vector<size_t> cuts = split_top_level_regions(data, size,
+			nthreads);
+		const size_t nregions = cuts.size() - 1;
+		auto parse = [&](ContextType& ctx, const char *ts, const char *te,
+			const text_loc& prev_loc) {
+			void *pparser = parsealloc(std::malloc);
+			assert(pparser != nullptr);
+			int rc = parse_region(ctx, pparser, ts, te, prev_loc);
+			parsefree(pparser, std::free);
+			return rc;
+		};
+		
+		if (nregions > 1) {
+			
+			// Find the line each region starts on, then parse them.
+			
+			std::vector<size_t> nlines(nregions, 0);
+			std::vector<std::deque<size_t>> queues(nregions);
+			for (size_t i=0; i<nregions; i++) {
+				queues[i].push_back(i);
+			}
+			run_work_stealing(queues, [&](size_t, const size_t i) {
+				nlines[i] = count_newlines(data + cuts[i],
+					data + cuts[i + 1]).count;
+			});
+			std::vector<ContextType> contexts(nregions);
+			std::vector<int> statuses(nregions, 0);
+			run_work_stealing(std::move(queues), [&](size_t, const size_t i) {
+				size_t lno = 1 + std::accumulate(nlines.begin(),
+					nlines.begin() + i, size_t(0));
+				statuses[i] = parse(contexts[i], data + cuts[i],
+					data + cuts[i + 1], text_loc{ lno, 0, lno, 0 });
+			});
+			if (std::all_of(statuses.begin(), statuses.end(),
+				[](const int rc) { return rc == 0; })) {
+				for (ContextType& ctx: contexts) {
+					graft(context, ctx);
+				}
+				return 0;
+			}
+		}
+		
+		context = ContextType();
+		return parse(context, data, data + size, FIRST_TEXT_LOC);
+	}
+	
+	
+	
 } // namespace largemelon
 
 
@@ -1007,6 +5094,25 @@ extern "C" { extern void NAME (void *, int, largemelon::lex_token *, \
 #define LARGEMELON_LEMON_PARSETRACE_DECL(PREFIX) \
 extern "C" { extern void NAME##Trace(FILE *, char *); }
 
+/**@brief Macro for the declaration of a <tt>ParseInit</tt>-like function
+ *   generated by Lemon.
+ * @param PREFIX Value of the <tt>%name</tt> directive in the Lemon parser
+ *   specification.
+ * @details This resolves to a function with name <em>PREFIX</em>Init and call
+ *   signature matching @ref largemelon::lemon_parseinit_func_type. Lemon has
+ *   generated it since version 3.20.*/
+#define LARGEMELON_LEMON_PARSEINIT_DECL(PREFIX) \
+extern "C" { extern void PREFIX##Init(void *); }
+
+/**@brief Macro for the declaration of a <tt>ParseFinalize</tt>-like function
+ *   generated by Lemon.
+ * @param PREFIX Value of the <tt>%name</tt> directive in the Lemon parser
+ *   specification.
+ * @details This resolves to a function with name <em>PREFIX</em>Finalize and
+ *   call signature matching @ref largemelon::lemon_parsefinalize_func_type.*/
+#define LARGEMELON_LEMON_PARSEFINALIZE_DECL(PREFIX) \
+extern "C" { extern void PREFIX##Finalize(void *); }
+
 /**@brief Macro for the declarations of the Lemon-generated functions with
  *  default names @c ParseAlloc, @c ParseFree, @c Parse, and @c ParseTrace.
  * @param PREFIX Value of the <tt>%name</tt> directive in the Lemon parser
@@ -1068,6 +5174,49 @@ LARGEMELON_LEMON_PARSETRACE_DECL(PREFIX)
 	(yy_find_shift_action((TOKEN_ID),((yyParser*)(PPARSER))->yytos->stateno) \
 	!= YY_ERROR_ACTION)
 
+/**@def LARGEMELON_EXPECTED_TOKEN_IDS_OLDER
+ * @brief Macro resolving to the set of all next-expected token IDs in a given
+ *   parser instance, as a <tt>std::bitset</tt> with a bit for each terminal
+ *   (see @ref largemelon::expected_token_cache). Use this if Lemon is
+ *   generating the older token interface.
+ * @param PPARSER Instance of parser (i.e., @c yypParser). Cannot be a null
+ *   pointer.
+ * @param NTOKENS Number of terminals, including end of input, which is one
+ *   more than the largest token ID in the generated header. (@c YYNTOKEN
+ *   may not be defined by older versions of Lemon.)
+ * @details Building an "expected one of ..." message or a completion list
+ *   this way asks Lemon about each terminal only once per parser state,
+ *   rather than once per query as with
+ *   @ref LARGEMELON_IS_NEXT_EXP_TOKEN_ID_OLDER.
+ * @internal Here, @c yy_find_shift_action looks at the parser's current
+ *   state itself, so it's only ever called for the state that is being
+ *   cached. The state is read from @c yytos, which older versions of Lemon
+ *   have kept the top of the parser stack in since 2016.*/
+#define LARGEMELON_EXPECTED_TOKEN_IDS_OLDER(PPARSER,NTOKENS) \
+	(largemelon::expected_token_cache<&yy_find_shift_action,(NTOKENS), \
+		(YYNSTATE)>::get( \
+		((yyParser*)(PPARSER))->yytos->stateno, \
+		[&](const int token_id, const int) { \
+			return LARGEMELON_IS_NEXT_EXP_TOKEN_ID_OLDER((PPARSER), \
+				(YYCODETYPE)token_id); }))
+
+/**@def LARGEMELON_EXPECTED_TOKEN_IDS_NEWER
+ * @brief Macro resolving to the set of all next-expected token IDs in a given
+ *   parser instance, as a <tt>std::bitset</tt> with a bit for each terminal
+ *   (see @ref largemelon::expected_token_cache). Use this if Lemon is
+ *   generating the newer token interface.
+ * @param PPARSER Instance of parser (i.e., @c yypParser). Cannot be a null
+ *   pointer.
+ * @details Same as @ref LARGEMELON_EXPECTED_TOKEN_IDS_OLDER, in place of
+ *   @ref LARGEMELON_IS_NEXT_EXP_TOKEN_ID_NEWER.*/
+#define LARGEMELON_EXPECTED_TOKEN_IDS_NEWER(PPARSER) \
+	(largemelon::expected_token_cache<&yy_find_shift_action,(YYNTOKEN), \
+		(YYNSTATE)>::get( \
+		((yyParser*)(PPARSER))->yytos->stateno, \
+		[](const int token_id, const int stateno) { \
+			return yy_find_shift_action((YYCODETYPE)token_id, \
+				(YYACTIONTYPE)stateno) != YY_ERROR_ACTION; }))
+
 
 
 #endif // LARGEMELON_LARGEMELON_HPP
@@ -12,10 +12,20 @@
 #include <doctest/doctest.h>
 #include "../largemelon.hpp"
 #include <algorithm> // std::count, ...
+#include <atomic>
+#include <bitset>
+#include <cctype>
 #include <cstdlib> // std::malloc
+#include <deque>
+#include <filesystem>
+#include <fstream>
 #include <memory> // std::unique_ptr
+#include <random>
+#include <regex>
+#include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <type_traits>
 #include <typeindex>
 #include <typeinfo>
@@ -141,6 +151,110 @@ namespace largemelon::test {
 		CHECK(indent_change == -2);
 	}
 	
+	/**@test A block indent tracker keeps the same blocks as the relative
+	 *   block indents updated line by line, and rejects a dedent that doesn't
+	 *   return to an open block without changing anything.*/
+	TEST_CASE("block_indent_tracker agrees with update_block_indents") {
+		const size_t widths[] = { 0, 2, 6, 6, 8, 12, 2, 4, 0, 3, 5, 14, 3, 0 };
+		largemelon::block_indent_tracker tracker;
+		std::vector<size_t> indents;
+		for (auto w: widths) {
+			int tracker_change = 0, indent_change = 0;
+			CHECK(tracker.update(tracker_change, w) == 0);
+			CHECK(largemelon::update_block_indents(indent_change, indents,
+				w) == 0);
+			CHECK(tracker_change == indent_change);
+			CHECK(tracker.depth() == indents.size());
+			CHECK(tracker.indent() == w);
+			CHECK(largemelon::block_indent_tracker(indents).indents()
+				== tracker.indents());
+		}
+		int indent_change = 0;
+		CHECK(tracker.update(indent_change, 4) == 0);
+		CHECK(tracker.update(indent_change, 9) == 0);
+		CHECK(tracker.update(indent_change, 6) != 0);
+		CHECK(tracker.indents() == std::vector<size_t>({ 4, 9 }));
+	}
+	
+	/**@test Measuring a line's indent counts its leading spaces and tabs
+	 *   according to the indent policy, across 16-character blocks, and the
+	 *   result can go straight to a block indent tracker.*/
+	TEST_CASE("measure_indent applies tab-stop policies") {
+		using largemelon::measure_indent;
+		size_t width, size;
+		std::string line = std::string(20, ' ') + "x = 1\n";
+		const char *ls = line.data(), *te = ls + line.size();
+		CHECK(measure_indent<largemelon::indent_spaces>(width, size, ls, te)
+			== 0);
+		CHECK(width == 20);
+		CHECK(size == 20);
+		line = "  \t \t\tx";
+		ls = line.data();
+		te = ls + line.size();
+		CHECK(measure_indent<largemelon::indent_spaces>(width, size, ls, te)
+			!= 0);
+		CHECK(measure_indent< largemelon::indent_tab_stops<4> >(width, size,
+			ls, te) == 0);
+		CHECK(width == 12);
+		CHECK(size == 6);
+		CHECK(measure_indent< largemelon::indent_no_mixed<4> >(width, size,
+			ls, te) != 0);
+		line = std::string(17, '\t');
+		ls = line.data();
+		te = ls + line.size();
+		CHECK(measure_indent< largemelon::indent_no_mixed<4> >(width, size,
+			ls, te) == 0);
+		CHECK(width == 68);
+		CHECK(size == 17);
+		largemelon::input_buffer buf;
+		buf.assign(line.data(), line.size());
+		CHECK(largemelon::measure_indent_padded<
+			largemelon::indent_tab_stops<8> >(width, size, buf.data(),
+			buf.data() + buf.size()) == 0);
+		CHECK(width == 136);
+		largemelon::block_indent_tracker tracker;
+		int indent_change = 0;
+		line = "\tif x:\n\t\ty = 2\n";
+		buf.assign(line.data(), line.size());
+		ls = buf.data();
+		te = ls + buf.size();
+		CHECK(tracker.update_line< largemelon::indent_tab_stops<8> >(
+			indent_change, size, ls, te) == 0);
+		CHECK(tracker.update_line< largemelon::indent_tab_stops<8> >(
+			indent_change, size, ls + 7, te) == 0);
+		CHECK(indent_change == 1);
+		CHECK(size == 2);
+		CHECK(tracker.indents() == std::vector<size_t>({ 8, 16 }));
+	}
+	
+	/**@test A change in block indent is passed to the parser as a run of
+	 *   null INDENT or DEDENT tokens sharing the location of the newline and
+	 *   indent before the line.*/
+	TEST_CASE("parse_indent_tokens passes a run of indent tokens") {
+		const size_t INDENT = 7, DEDENT = 8;
+		std::vector<int> ids;
+		largemelon::lemon_parse_func_type<int> parse_func
+			= [&ids](void *, int token_id, largemelon::lex_token *ptoken,
+				int *) {
+				CHECK(ptoken == nullptr);
+				ids.push_back(token_id);
+			};
+		std::string mtext;
+		largemelon::text_loc loc = largemelon::FIRST_TEXT_LOC;
+		int context = 0, parser = 0;
+		const std::string text = "a:\n    b\nc\n";
+		const char *p = text.data();
+		CHECK(largemelon::parse_indent_tokens(mtext, loc, context, "",
+			parse_func, p + 2, p + 7, &parser, INDENT, DEDENT, 1, 0) == 1);
+		CHECK(ids == std::vector<int>({ 7 }));
+		CHECK(largemelon::parse_indent_tokens(mtext, loc, context, "",
+			parse_func, p + 8, p + 9, &parser, INDENT, DEDENT, 0, 0) == 0);
+		CHECK(largemelon::parse_indent_tokens(mtext, loc, context, "",
+			parse_func, p + 8, p + 9, &parser, INDENT, DEDENT, -3, 0) == 3);
+		CHECK(ids == std::vector<int>({ 7, 8, 8, 8 }));
+		CHECK(mtext == "\n");
+	}
+	
 	
 	
 	/**@test A location in text is considered "less than" another location if
@@ -373,6 +487,138 @@ namespace largemelon::test {
 		CHECK(node.is_root());
 	}
 	
+	/**@test An AST node can be cast back to its class type through its
+	 *   enumerated type, and to no other class type.*/
+	TEST_CASE("node_cast checks the node type tag") {
+		auto b = new ast_bool_literal({ 1, 10, 1, 13 }, true);
+		ast_data_decl decl({ 1, 1, 1, 14 }, "x", b);
+		ast_base *n = decl.expr();
+		const ast_base *cn = &decl;
+		CHECK_EQ(ast_bool_literal::TYPE, nt::BOOL_LITERAL);
+		CHECK(largemelon::node_cast<ast_bool_literal>(n) == b);
+		CHECK(largemelon::node_cast<ast_binop_logor>(n) == nullptr);
+		CHECK(largemelon::node_cast<ast_data_decl>(cn)->name() == "x");
+		CHECK(largemelon::node_cast<ast_bool_literal>(cn) == nullptr);
+		CHECK(largemelon::node_cast<ast_bool_literal>(
+			static_cast<ast_base *>(nullptr)) == nullptr);
+	}
+	
+	/**@test Visiting an AST node calls the handler for its class type,
+	 *   falling back to a generic handler for any other type.*/
+	TEST_CASE("visit dispatches on the node type tag") {
+		auto b = new ast_bool_literal({ 1, 10, 1, 13 }, true);
+		auto c = new ast_bool_literal({ 1, 18, 1, 22 }, false);
+		ast_data_decl decl({ 1, 1, 1, 23 }, "x",
+			new ast_binop_logor({ 1, 10, 1, 22 }, b, c));
+		std::string out;
+		std::function<void(ast_base&)> print = [&](ast_base& n) {
+			largemelon::visit(n, largemelon::overloaded{
+				[&](ast_bool_literal& lit) {
+					out += lit.value() ? "true" : "false";
+				},
+				[&](ast_binop_logor& logor) {
+					print(*logor.lexpr());
+					out += " || ";
+					print(*logor.rexpr());
+				},
+				[&](ast_data_decl& d) {
+					out += "data " + std::string(d.name()) + " = ";
+					print(*d.expr());
+					out += ";";
+				},
+			});
+		};
+		print(decl);
+		CHECK_EQ(out, "data x = true || false;");
+		const ast_base& cb = *b;
+		auto depth = largemelon::overloaded{
+			[](const ast_data_decl&) { return 0; },
+			[](const auto& n) { return n.is_root() ? -1 : 2; },
+		};
+		CHECK_EQ(largemelon::visit(static_cast<const ast_base&>(decl), depth),
+			0);
+		CHECK_EQ(largemelon::visit(cb, depth), 2);
+		CHECK_EQ(largemelon::visit(cb, largemelon::overloaded{
+			[](const ast_data_decl&) { return 1; } }), 0);
+	}
+	
+	/**@brief AST node of one of many types, numbered by @c int.*/
+	template <int N>
+	class ast_numbered : public largemelon::ast_typed_base_type<int, N> {
+	public:
+		ast_numbered() : largemelon::ast_typed_base_type<int, N>(
+			EMPTY_TEXT_LOC) {}
+	};
+	
+	/**@brief Whether visiting an @c int-numbered AST node with handlers goes
+	 *   through a jump table.*/
+	template <typename... HandlerTypes>
+	constexpr bool uses_visit_table(
+		const largemelon::overloaded<HandlerTypes...>&) {
+		return largemelon::visit_table<int, largemelon::ast_base_type<int>,
+			largemelon::overloaded<HandlerTypes...>, HandlerTypes...>::ENABLED;
+	}
+	
+	/**@test With many handlers for closely numbered node types, visiting
+	 *   goes through a jump table, with the same results as comparing with
+	 *   each handler's type in turn.*/
+	TEST_CASE("visit dispatches many node types through a jump table") {
+		auto visitor = largemelon::overloaded{
+			[](ast_numbered<3>&) { return 30; },
+			[](ast_numbered<4>&) { return 40; },
+			[](ast_numbered<5>&) { return 50; },
+			[](ast_numbered<6>&) { return 60; },
+			[](ast_numbered<8>&) { return 80; },
+			[](ast_numbered<9>&) { return 90; },
+			[](ast_numbered<10>&) { return 100; },
+			[](ast_numbered<11>&) { return 110; },
+			[](ast_numbered<12>&) { return 120; },
+			[](largemelon::ast_base_type<int>& n) { return -n.type(); },
+		};
+		CHECK(uses_visit_table(visitor));
+		CHECK(! uses_visit_table(largemelon::overloaded{
+			[](ast_numbered<3>&) { return 30; },
+			[](ast_numbered<4>&) { return 40; } }));
+		ast_numbered<3> n3;
+		ast_numbered<7> n7;
+		ast_numbered<9> n9;
+		ast_numbered<12> n12;
+		ast_numbered<1> n1;
+		ast_numbered<20> n20;
+		CHECK_EQ(largemelon::visit(n3, visitor), 30);
+		CHECK_EQ(largemelon::visit(n7, visitor), -7);
+		CHECK_EQ(largemelon::visit(n9, visitor), 90);
+		CHECK_EQ(largemelon::visit(n12, visitor), 120);
+		CHECK_EQ(largemelon::visit(n1, visitor), -1);
+		CHECK_EQ(largemelon::visit(n20, visitor), -20);
+		const auto& cvisitor = visitor;
+		CHECK_EQ(largemelon::visit(n9, cvisitor), 90);
+		CHECK_EQ(largemelon::visit(n20, cvisitor), -20);
+	}
+	
+	/**@test Handlers are called through a reference rather than copied, so
+	 *   that @c mutable handlers keep their state from one visit to the
+	 *   next.*/
+	TEST_CASE("visit keeps the state of mutable handlers") {
+		int nfallbacks = 0;
+		auto visitor = largemelon::overloaded{
+			[count = 0](ast_numbered<1>&) mutable { return ++count; },
+			[&nfallbacks, count = 0](largemelon::ast_base_type<int>&) mutable {
+				nfallbacks = ++count;
+				return 0;
+			},
+		};
+		ast_numbered<1> n1;
+		ast_numbered<2> n2;
+		CHECK_EQ(largemelon::visit(n1, visitor), 1);
+		CHECK_EQ(largemelon::visit(n1, visitor), 2);
+		for (int i=0; i<3; i++) {
+			largemelon::visit(n2, visitor);
+		}
+		CHECK_EQ(nfallbacks, 3);
+		CHECK_EQ(largemelon::visit(n1, visitor), 3);
+	}
+	
 	/**@test For an AST node @c binop with no parent node and two child nodes
 	 *   @c lexpr and @c rexpr, @c binop is the AST's root node, and neither
 	 *   @c lexpr nor @c rexpr is the root node.*/
@@ -403,6 +649,189 @@ namespace largemelon::test {
 		delete decl;
 	}
 	
+	/**@test Each emitted top-level node is consumed, then released, one at a
+	 *   time, so no more than one is ever alive.*/
+	TEST_CASE("ast_stream_sink consumes then releases each node") {
+		std::vector<std::string> names;
+		int nalive = 0, max_alive = 0;
+		ast_stream_sink<nt> sink(
+			[&](ast_base& node) {
+				CHECK_EQ(node.type(), nt::DATA_DECL);
+				names.emplace_back(static_cast<ast_data_decl&>(node).name());
+			},
+			[&](ast_base *node) {
+				nalive--;
+				delete node;
+			});
+		for (int i=0; i<5; i++) {
+			auto decl = new ast_data_decl({ size_t(i) + 1, 1, size_t(i) + 1, 9 },
+				"decl" + std::to_string(i),
+				new ast_bool_literal({ size_t(i) + 1, 5, size_t(i) + 1, 9 },
+					true));
+			nalive++;
+			max_alive = std::max(max_alive, nalive);
+			sink.emit(decl);
+		}
+		sink.emit(nullptr);
+		CHECK_EQ(sink.count(), 5);
+		CHECK_EQ(nalive, 0);
+		CHECK_EQ(max_alive, 1);
+		CHECK_EQ(names, std::vector<std::string>{ "decl0", "decl1", "decl2",
+			"decl3", "decl4" });
+	}
+	
+	/**@brief AST node for a list of expressions owned elsewhere.*/
+	class ast_test_list : public ast_typed_base<nt::ROOT> {
+	public:
+		ast_test_list() : ast_typed_base<nt::ROOT>(EMPTY_TEXT_LOC) {}
+		using ast_typed_base<nt::ROOT>::add_child;
+		using ast_typed_base<nt::ROOT>::add_child_range;
+	};
+	
+	/**@test A node takes each child node once, however many times it's added,
+	 *   and a range of child nodes can be added in one call.*/
+	TEST_CASE("add_child_range skips duplicate and null child nodes") {
+		std::vector< std::unique_ptr<ast_bool_literal> > owned;
+		std::vector<ast_base*> elems;
+		for (size_t i=0; i<100000; i++) {
+			owned.emplace_back(new ast_bool_literal(
+				{ 1, 1 + 6*i, 1, 5 + 6*i }, i % 2 == 0));
+			elems.push_back(owned.back().get());
+		}
+		elems.push_back(nullptr);
+		elems.push_back(elems.front());
+		ast_test_list list;
+		list.add_child_range(elems.begin(), elems.end());
+		list.add_child(elems.back());
+		list.add_child_range(elems.begin(), elems.begin() + 10);
+		CHECK_EQ(list.childs().size(), 100000);
+		CHECK(list.childs().back() == owned.back().get());
+		CHECK(owned[12345]->parent() == &list);
+	}
+	
+	/**@test A small vector keeps its first few elements inline and moves
+	 *   them to the heap as it grows, with the same results as a
+	 *   @c std::vector; AST nodes with few child nodes keep them inline.*/
+	TEST_CASE("small_vector keeps few elements inline") {
+		largemelon::small_vector<int, 4> sv;
+		std::vector<int> v;
+		for (int i=0; i<4; i++) {
+			sv.push_back(i);
+			v.push_back(i);
+		}
+		CHECK(sv.is_inline());
+		largemelon::small_vector<int, 4> moved(std::move(sv));
+		CHECK(moved.is_inline());
+		CHECK(sv.empty());
+		for (int i=4; i<40; i++) {
+			moved.push_back(i);
+			v.push_back(i);
+		}
+		CHECK(! moved.is_inline());
+		const int more[] = { 100, 101, 102 };
+		moved.insert(moved.begin() + 5, std::begin(more), std::end(more));
+		v.insert(v.begin() + 5, std::begin(more), std::end(more));
+		moved.erase(moved.begin() + 1, moved.begin() + 3);
+		v.erase(v.begin() + 1, v.begin() + 3);
+		largemelon::small_vector<int, 4> copied = moved;
+		CHECK(copied == moved);
+		CHECK(std::vector<int>(copied.begin(), copied.end()) == v);
+		sv = std::move(moved);
+		CHECK(std::vector<int>(sv.begin(), sv.end()) == v);
+		CHECK(moved.is_inline());
+		auto b = new ast_bool_literal({ 1, 1, 1, 4 }, true);
+		auto c = new ast_bool_literal({ 1, 9, 1, 13 }, false);
+		ast_binop_logor logor({ 1, 1, 1, 13 }, b, c);
+		CHECK(logor.childs().is_inline());
+		CHECK_EQ(logor.childs().size(), 2);
+	}
+	
+	/**@brief AST node for a logical-or expression whose operands are owned
+	 *   elsewhere, as by an @ref largemelon::ast_node_arena.*/
+	class ast_arena_logor : public ast_typed_base<nt::BINOP_LOGOR> {
+		/**@brief Counter decremented on destruction.*/
+		int *nalive_;
+	public:
+		ast_arena_logor(const largemelon::text_loc& loc, ast_base* const lexpr,
+			ast_base* const rexpr, int *const nalive)
+			: ast_typed_base<nt::BINOP_LOGOR>(loc), nalive_(nalive) {
+			add_childs(lexpr, rexpr);
+			(*nalive_)++;
+		}
+		~ast_arena_logor() { (*nalive_)--; }
+	};
+	
+	/**@test Nodes made by an AST node arena are linked as usual, and all of
+	 *   them are destroyed by a single release.*/
+	TEST_CASE("ast_node_arena destroys every node on release") {
+		int nalive = 0;
+		largemelon::ast_node_arena<nt> nodes(256);
+		ast_base *expr = nodes.make<ast_bool_literal>(
+			text_loc{ 1, 1, 1, 4 }, true);
+		for (size_t i=0; i<100; i++) {
+			ast_base *b = nodes.make<ast_bool_literal>(
+				text_loc{ 1, 9 + 9*i, 1, 13 + 9*i }, false);
+			expr = nodes.make<ast_arena_logor>(
+				span_loc(expr->loc(), b->loc()), expr, b, &nalive);
+			CHECK(b->parent() == expr);
+		}
+		CHECK_EQ(nodes.size(), 201);
+		CHECK_EQ(nalive, 100);
+		CHECK(expr->is_root());
+		CHECK_EQ(expr->childs().size(), 2);
+		CHECK_EQ(expr->loc(), text_loc{ 1, 1, 1, 904 });
+		nodes.release();
+		CHECK_EQ(nodes.size(), 0);
+		CHECK_EQ(nalive, 0);
+		nodes.make<ast_arena_logor>(EMPTY_TEXT_LOC, nullptr, nullptr, &nalive);
+		CHECK_EQ(nalive, 1);
+	}
+	
+	/**@test Grammar actions can build a flat AST bottom-up, with names in a
+	 *   side table, and its nodes can be walked through handles as with
+	 *   pointer-based AST nodes.*/
+	TEST_CASE("flat_ast built bottom-up is walked through node handles") {
+		largemelon::flat_ast<nt> ast;
+		std::vector<std::string> names;
+		using node_id = largemelon::flat_ast<nt>::node_id;
+		// data x = true || false;
+		// data y = x || true;
+		node_id root = ast.add_node(nt::ROOT, EMPTY_TEXT_LOC);
+		for (size_t line=1; line<=2; line++) {
+			node_id l = ast.add_node(nt::BOOL_LITERAL, { line, 10, line, 13 });
+			node_id r = ast.add_node(nt::BOOL_LITERAL, { line, 18, line, 22 });
+			node_id logor = ast.add_node(nt::BINOP_LOGOR,
+				span_loc(ast.loc(l), ast.loc(r)));
+			ast.add_childs(logor, l, r, l);
+			names.push_back(line == 1 ? "x" : "y");
+			node_id decl = ast.add_node(nt::DATA_DECL, { line, 1, line, 23 },
+				static_cast<std::uint32_t>(names.size() - 1));
+			ast.add_child(decl, logor);
+			ast.add_child(root, decl);
+		}
+		CHECK_EQ(ast.size(), 9);
+		auto r = ast.node(root);
+		CHECK(r.is_root());
+		CHECK_EQ(r.childs().size(), 2);
+		std::vector<std::string> decl_names;
+		for (auto decl: r.childs()) {
+			CHECK_EQ(decl.type(), nt::DATA_DECL);
+			CHECK(decl.parent() == r);
+			decl_names.push_back(names[decl.payload()]);
+			auto logor = *decl.childs().begin();
+			CHECK_EQ(logor.type(), nt::BINOP_LOGOR);
+			CHECK_EQ(logor.childs().size(), 2);
+			for (auto lit: logor.childs()) {
+				CHECK_EQ(lit.type(), nt::BOOL_LITERAL);
+				CHECK(lit.root() == r);
+				CHECK_EQ(lit.payload(), largemelon::flat_ast<nt>::NO_PAYLOAD);
+			}
+		}
+		CHECK_EQ(decl_names, std::vector<std::string>{ "x", "y" });
+		CHECK_EQ(std::count(ast.types().begin(), ast.types().end(),
+			nt::BOOL_LITERAL), 4);
+	}
+	
 	//~ /**@test */
 	//~ TEST_CASE("immed_typed_child for data declaration") {
 		
@@ -492,4 +921,1121 @@ namespace largemelon::test {
 	
 	
 	
+	/**@brief Writes a temporary file, for tests that read input from
+	 *   files.
+	 * @param name File name, within the system's temporary directory.
+	 * @param contents File contents.
+	 * @return Path to the written file.*/
+	inline std::filesystem::path write_temp_file(const std::string& name,
+		const std::string& contents) {
+		auto fpath = std::filesystem::temp_directory_path() / name;
+		std::ofstream ofs(fpath, std::ios::binary);
+		ofs << contents;
+		return fpath;
+	}
+	
+	/**@test */
+	TEST_SUITE("input_buffer tests") {
+		/**@test A mapped file's contents are exactly those of the file, and
+		 *   the scanner registers span all of them.*/
+		TEST_CASE("map file and set scanner input") {
+			auto fpath = write_temp_file("largemelon_map.txt", "x = 1;\ny = 2;\n");
+			input_buffer buf;
+			REQUIRE_EQ(buf.map_file(fpath), 0);
+			CHECK_EQ(std::string(buf.data(), buf.size()), "x = 1;\ny = 2;\n");
+			ragel_scanner_pers_type rp;
+			set_scanner_input(rp, buf);
+			CHECK_EQ(rp.p, buf.data());
+			CHECK_EQ(rp.pe, buf.data() + 14);
+			CHECK_EQ(rp.eof, rp.pe);
+			buf.close();
+			CHECK_EQ(buf.size(), 0);
+			std::filesystem::remove(fpath);
+		}
+		/**@test An empty file maps to an empty buffer.*/
+		TEST_CASE("map empty file") {
+			auto fpath = write_temp_file("largemelon_empty.txt", "");
+			input_buffer buf;
+			REQUIRE_EQ(buf.map_file(fpath), 0);
+			CHECK_EQ(buf.size(), 0);
+			CHECK_NE(buf.data(), nullptr);
+			std::filesystem::remove(fpath);
+		}
+		/**@test A file that doesn't exist can't be mapped.*/
+		TEST_CASE("map missing file") {
+			input_buffer buf;
+			CHECK_NE(buf.map_file("/nonexistent/largemelon.txt"), 0);
+			CHECK_EQ(buf.size(), 0);
+		}
+		/**@test However an input buffer is filled, its text is aligned and
+		 *   followed by a NUL sentinel and then by zero padding, even when the
+		 *   text fills a whole number of pages.*/
+		TEST_CASE("input is aligned and padded") {
+			const std::string text(8192, 'z');
+			auto fpath = write_temp_file("largemelon_padded.txt", text);
+			std::istringstream iss(text);
+			input_buffer bufs[4];
+			REQUIRE_EQ(bufs[0].map_file(fpath), 0);
+			REQUIRE_EQ(bufs[1].read_file(fpath), 0);
+			REQUIRE_EQ(bufs[2].read_stream(iss), 0);
+			bufs[3].assign(text.data(), text.size());
+			for (auto& buf: bufs) {
+				CHECK_EQ(std::string(buf.data(), buf.size()), text);
+				CHECK_EQ(reinterpret_cast<uintptr_t>(buf.data()) % 4096, 0);
+				size_t nzeros = 0;
+				for (size_t i=0; i<=INPUT_BUFFER_PADDING; i++) {
+					nzeros += (buf.data()[buf.size() + i] == '\0');
+				}
+				CHECK_EQ(nzeros, INPUT_BUFFER_PADDING + 1);
+			}
+			std::filesystem::remove(fpath);
+		}
+	}
+	
+	/**@test The block-wise newline counters agree with a plain regex search
+	 *   for newline sequences, for every span of a text mixing all three
+	 *   newline conventions, including sequences split across blocks.*/
+	TEST_CASE("count_newlines matches regex search") {
+		static const std::regex RGX_NL = std::regex(R"(\r\n|\r|\n)");
+		std::mt19937 rng(7);
+		std::string text;
+		for (size_t i=0; i<300; i++) {
+			text.push_back("ab\r\n"[rng() % 4]);
+		}
+		input_buffer buf;
+		buf.assign(text.data(), text.size());
+		for (size_t b=0; b<text.size(); b+=7) {
+			for (size_t e=b; e<=text.size(); e+=5) {
+				size_t count = 0, tail_pos = 0;
+				std::string sub = text.substr(b, e - b);
+				auto nli = std::sregex_iterator(sub.cbegin(), sub.cend(), RGX_NL);
+				for (; nli!=std::sregex_iterator(); nli++) {
+					count++;
+					tail_pos = nli->position(0) + nli->length(0);
+				}
+				newline_count nc = count_newlines(text.data() + b,
+					text.data() + e);
+				newline_count ncp = count_newlines_padded(buf.data() + b,
+					buf.data() + e);
+				REQUIRE_EQ(nc.count, count);
+				REQUIRE_EQ(nc.tail_pos, tail_pos);
+				REQUIRE_EQ(ncp.count, count);
+				REQUIRE_EQ(ncp.tail_pos, tail_pos);
+			}
+		}
+	}
+	
+	/**@test Normalizing a text with a byte order mark and all three newline
+	 *   conventions, in place or from a mapped file, leaves only @c '\n'
+	 *   newlines, and locations found with @ref mtext_loc_lf in the result
+	 *   map back to those of the original text.*/
+	TEST_CASE("normalize_newlines maps locations back to the original text") {
+		std::mt19937 rng(5);
+		std::string text = "\xEF\xBB\xBF";
+		for (size_t i=0; i<600; i++) {
+			text.push_back("ab \r\n"[rng() % 5]);
+		}
+		std::string expected = std::regex_replace(text.substr(3),
+			std::regex("\r\n?"), "\n");
+		auto fpath = write_temp_file("largemelon_normalize.txt", text);
+		input_buffer bufs[2];
+		REQUIRE_EQ(bufs[0].map_file(fpath), 0);
+		bufs[1].assign(text.data(), text.size());
+		newline_map map;
+		for (auto& buf: bufs) {
+			buf.normalize_newlines(map);
+			CHECK_EQ(std::string(buf.data(), buf.size()), expected);
+			size_t nzeros = 0;
+			for (size_t i=buf.size(); i<text.size()+INPUT_BUFFER_PADDING; i++) {
+				nzeros += (buf.data()[i] == '\0');
+			}
+			CHECK_EQ(nzeros, text.size() + INPUT_BUFFER_PADDING - buf.size());
+		}
+		CHECK_EQ(map.bom_size, 3);
+		
+		const char *data = bufs[1].data();
+		line_index orig_lines(text.data(), text.size());
+		text_loc loc = FIRST_TEXT_LOC;
+		size_t prev_end = 0;
+		for (size_t b=0; b<expected.size(); ) {
+			if (expected[b] == ' ' || expected[b] == '\n') {
+				b++;
+				continue;
+			}
+			size_t e = b;
+			while (e < expected.size() && expected[e] != ' '
+				&& expected[e] != '\n') {
+				e++;
+			}
+			CHECK_EQ(text[map.original_offset(b)], expected[b]);
+			loc = mtext_loc_lf(loc, data + prev_end, data + b);
+			loc = mtext_loc_lf_padded(loc, data + b, data + e);
+			CHECK_EQ(map.original_loc(loc), orig_lines.loc(
+				map.original_offset(b), map.original_offset(e - 1) + 1));
+			prev_end = b = e;
+		}
+		for (size_t b=0; b<expected.size(); b+=7) {
+			for (size_t e=b; e<=expected.size(); e+=5) {
+				newline_count nc = count_newlines(data + b, data + e);
+				newline_count ncl = count_newlines_lf(data + b, data + e);
+				REQUIRE_EQ(ncl.count, nc.count);
+				REQUIRE_EQ(ncl.tail_pos, nc.tail_pos);
+			}
+		}
+		std::filesystem::remove(fpath);
+	}
+	
+	
+	
+	/**@brief Stands in for a Ragel-generated scanner, matching runs of
+	 *   non-whitespace characters as tokens and skipping whitespace.
+	 * @details Like a Ragel scanner, this leaves @c rp.ts set when it runs out
+	 *   of input partway through a token, unless it's at the end of input.
+	 * @param rp Scanner registers.
+	 * @param words Matched tokens.
+	 * @param locs Locations of matched tokens.
+	 * @param loc Location of the last matched or skipped text.*/
+	inline void scan_words(ragel_scanner_pers_type& rp,
+		std::vector<std::string>& words, std::vector<text_loc>& locs,
+		text_loc& loc) {
+		auto emit = [&]() {
+			words.push_back(toktext(rp.ts, rp.te));
+			loc = mtext_loc_padded(loc, rp.ts, rp.te);
+			locs.push_back(loc);
+			rp.ts = nullptr;
+		};
+		for (; rp.p<rp.pe; rp.p++) {
+			bool ws = std::isspace(static_cast<unsigned char>(*rp.p));
+			if (rp.ts != nullptr && ws) {
+				rp.te = rp.p;
+				emit();
+			}
+			if (ws) {
+				loc = mtext_loc(loc, rp.p, rp.p + 1);
+			}
+			else if (rp.ts == nullptr) {
+				rp.ts = rp.p;
+			}
+		}
+		if (rp.p == rp.eof && rp.ts != nullptr) {
+			rp.te = rp.p;
+			emit();
+		}
+	}
+	
+	/**@test Whatever the chunk size, chunked scanning matches the same tokens
+	 *   at the same locations as scanning the whole input at once, and the
+	 *   buffer only grows to fit the chunk size plus the longest token.*/
+	TEST_CASE("chunked scanning preserves tokens straddling chunks") {
+		std::string text = "alpha beta\ngamma  delta\n\n"
+			"an_exceptionally_long_token_spanning_many_chunks\repsilon";
+		for (size_t chunk_size: { 1, 3, 7, 4096 }) {
+			std::istringstream iss(text);
+			chunked_scanner_input input(istream_input_source(iss), chunk_size);
+			ragel_scanner_pers_type rp;
+			rp.ts = rp.te = nullptr;
+			std::vector<std::string> words;
+			std::vector<text_loc> locs;
+			text_loc loc = FIRST_TEXT_LOC;
+			size_t last_offset = 0;
+			do {
+				REQUIRE_EQ(input.refill(rp), 0);
+				if (rp.ts != nullptr) {
+					last_offset = input.offset_of(rp.ts);
+				}
+				scan_words(rp, words, locs, loc);
+			} while (! input.at_eof());
+			CHECK_EQ(words, std::vector<std::string>{ "alpha", "beta", "gamma",
+				"delta", "an_exceptionally_long_token_spanning_many_chunks",
+				"epsilon" });
+			REQUIRE_EQ(locs.size(), 6);
+			CHECK_EQ(locs[0], text_loc{1, 1, 1, 5});
+			CHECK_EQ(locs[2], text_loc{2, 1, 2, 5});
+			CHECK_EQ(locs[4], text_loc{4, 1, 4, 48});
+			CHECK_EQ(locs[5], text_loc{5, 1, 5, 7});
+			CHECK_LE(input.capacity(), chunk_size + 48);
+			if (chunk_size < 48) {
+				CHECK_GT(last_offset, 0);
+			}
+		}
+	}
+	
+	/**@test Reading ahead on a background thread hands out the same input,
+	 *   in the same order, as the wrapped source, even when the source
+	 *   returns short reads as a pipe does.*/
+	TEST_CASE("read-ahead input source preserves input") {
+		std::string text;
+		for (int i=0; i<2000; i++) {
+			text += "word" + std::to_string(i) + ((i % 7) ? " " : "\n");
+		}
+		size_t pos = 0;
+		auto trickle = [&](char *dest, const size_t n) -> std::ptrdiff_t {
+			size_t k = std::min({ n, size_t(13), text.size() - pos });
+			std::memcpy(dest, text.data() + pos, k);
+			pos += k;
+			return static_cast<std::ptrdiff_t>(k);
+		};
+		chunked_scanner_input input(read_ahead_input_source(trickle, 64), 64);
+		ragel_scanner_pers_type rp;
+		rp.ts = rp.te = nullptr;
+		std::vector<std::string> words;
+		std::vector<text_loc> locs;
+		text_loc loc = FIRST_TEXT_LOC;
+		do {
+			REQUIRE_EQ(input.refill(rp), 0);
+			scan_words(rp, words, locs, loc);
+		} while (! input.at_eof());
+		REQUIRE_EQ(words.size(), 2000);
+		CHECK_EQ(words[0], "word0");
+		CHECK_EQ(words[1999], "word1999");
+		CHECK_EQ(locs[1999].first_lno, 287);
+	}
+	
+	/**@test An error from the source wrapped by a read-ahead input source is
+	 *   reported after the input read before it.*/
+	TEST_CASE("read-ahead input source reports errors") {
+		int calls = 0;
+		read_ahead_input_source source([&calls](char *dest, const size_t n)
+			-> std::ptrdiff_t {
+			if (calls++ > 0) {
+				return -1;
+			}
+			std::memset(dest, 'x', n);
+			return static_cast<std::ptrdiff_t>(n);
+		}, 8);
+		char buf[8];
+		CHECK_EQ(source(buf, 5), 5);
+		CHECK_EQ(source(buf, 8), 3);
+		CHECK_EQ(source(buf, 8), -1);
+		CHECK_EQ(source(buf, 8), -1);
+	}
+	
+	
+	
+	/**@test Work stealing runs every task exactly once, even when all of
+	 *   them start in a single thread's queue.*/
+	TEST_CASE("run_work_stealing runs every task once") {
+		std::vector<std::atomic<int>> runs(200);
+		std::vector<std::deque<size_t>> queues(4);
+		for (size_t i=0; i<runs.size(); i++) {
+			queues[0].push_back(i);
+		}
+		std::vector<std::atomic<int>> busy(4);
+		run_work_stealing(queues, [&](const size_t w, const size_t i) {
+			CHECK_EQ(busy[w]++, 0);
+			runs[i]++;
+			std::this_thread::yield();
+			busy[w]--;
+		});
+		for (auto& n: runs) {
+			CHECK_EQ(n.load(), 1);
+		}
+	}
+	
+	/**@brief Stands in for a Lemon-generated parser in @ref parse_files
+	 *   tests, counting the files it's used for.*/
+	struct fake_parser {
+		std::atomic<int> in_use{0};
+		int nfiles = 0;
+		/**@brief Whether a parse was left unfinished, as by an error before
+		 *   the end-of-input token.*/
+		bool mid_parse = false;
+	};
+	
+	/**@brief Parsing context for @ref parse_files tests.*/
+	struct fake_context {
+		std::string name;
+		std::unique_ptr<int> ast;
+	};
+	
+	/**@test Parsing many files gives results in the order of the paths, with
+	 *   at most one parser per thread that is only used by one file at a
+	 *   time.*/
+	TEST_CASE("parse_files merges results in input order") {
+		std::vector<std::filesystem::path> fpaths;
+		for (int i=0; i<50; i++) {
+			fpaths.push_back("file" + std::to_string(i) + ".txt");
+		}
+		std::atomic<int> nallocs{0};
+		std::atomic<int> nfrees{0};
+		std::atomic<int> nparsed{0};
+		std::vector<file_parse_result<fake_context>> results;
+		int nfailed = parse_files<fake_context>(results, fpaths,
+			[&](malloc_func_type) -> void * {
+				nallocs++;
+				return new fake_parser();
+			},
+			[&](void *pparser, free_func_type) {
+				nparsed += static_cast<fake_parser *>(pparser)->nfiles;
+				delete static_cast<fake_parser *>(pparser);
+				nfrees++;
+			},
+			[](fake_context& ctx, void *pparser,
+				const std::filesystem::path& fpath) {
+				fake_parser& parser = *static_cast<fake_parser *>(pparser);
+				CHECK_EQ(parser.in_use++, 0);
+				parser.nfiles++;
+				ctx.name = fpath.stem().string();
+				ctx.ast = std::make_unique<int>(ctx.name.size());
+				std::this_thread::yield();
+				parser.in_use--;
+				return (ctx.name == "file7") ? 1 : 0;
+			}, 4);
+		CHECK_EQ(nfailed, 1);
+		CHECK_GE(nallocs.load(), 1);
+		CHECK_LE(nallocs.load(), 4);
+		CHECK_EQ(nfrees.load(), nallocs.load());
+		CHECK_EQ(nparsed.load(), 50);
+		REQUIRE_EQ(results.size(), 50);
+		for (size_t i=0; i<results.size(); i++) {
+			CHECK_EQ(results[i].fpath, fpaths[i]);
+			CHECK_EQ(results[i].context.name, fpaths[i].stem().string());
+			CHECK_EQ(results[i].status, (i == 7) ? 1 : 0);
+		}
+	}
+	
+	
+	
+	/**@test Files are planned largest first onto the least-loaded thread,
+	 *   with small files batched together and every file in exactly one
+	 *   task.*/
+	TEST_CASE("plan_file_tasks batches small files and balances loads") {
+		std::vector<uintmax_t> sizes = { 100, 1, 1, 1, 50, 60, 1 };
+		file_task_plan plan = plan_file_tasks(sizes, 2, 10, 0);
+		REQUIRE_EQ(plan.tasks.size(), 4);
+		CHECK_EQ(plan.tasks[0], std::vector<size_t>{ 0 });
+		CHECK_EQ(plan.tasks[1], std::vector<size_t>{ 5 });
+		CHECK_EQ(plan.tasks[2], std::vector<size_t>{ 4 });
+		CHECK_EQ(plan.tasks[3], std::vector<size_t>{ 1, 2, 3, 6 });
+		REQUIRE_EQ(plan.queues.size(), 2);
+		CHECK_EQ(plan.queues[0], std::deque<size_t>{ 0, 3 });
+		CHECK_EQ(plan.queues[1], std::deque<size_t>{ 1, 2 });
+		CHECK_EQ(plan.loads, std::vector<uintmax_t>{ 104, 110 });
+		
+		// per-file overhead stops empty files from piling into one batch
+		plan = plan_file_tasks(std::vector<uintmax_t>(10, 0), 3, 10, 4);
+		CHECK_EQ(plan.tasks.size(), 5);
+		CHECK_EQ(plan.loads, std::vector<uintmax_t>{ 16, 16, 8 });
+	}
+	
+	/**@test A parser given back to a pool is reset and handed out again,
+	 *   instead of a new one being allocated.*/
+	TEST_CASE("lemon_parser_pool reuses and resets parsers") {
+		int nallocs = 0, nfrees = 0, ninits = 0, nfinalizes = 0;
+		{
+			lemon_parser_pool pool(
+				[&](malloc_func_type) -> void * {
+					nallocs++;
+					return new fake_parser();
+				},
+				[&](void *pparser, free_func_type) {
+					nfrees++;
+					delete static_cast<fake_parser *>(pparser);
+				},
+				[&](void *pparser) {
+					ninits++;
+					static_cast<fake_parser *>(pparser)->nfiles = 0;
+				},
+				[&](void *) { nfinalizes++; });
+			void *first;
+			{
+				lemon_parser_pool::lease parser(pool);
+				first = parser.get();
+				static_cast<fake_parser *>(first)->nfiles = 3;
+			}
+			CHECK_EQ(ninits, 1);
+			CHECK_EQ(nfinalizes, 1);
+			{
+				lemon_parser_pool::lease parser(pool);
+				lemon_parser_pool::lease other(pool);
+				CHECK_EQ(parser.get(), first);
+				CHECK_EQ(static_cast<fake_parser *>(parser.get())->nfiles, 0);
+				CHECK_NE(other.get(), first);
+			}
+			CHECK_EQ(pool.nallocs(), 2);
+		}
+		CHECK_EQ(nallocs, 2);
+		CHECK_EQ(nfrees, 2);
+		CHECK_EQ(ninits, 3);
+	}
+	
+	/**@test A file whose parse fails partway doesn't leave the next file on
+	 *   the same thread with a parser in the middle of a parse, whether the
+	 *   parser is reset or replaced.*/
+	TEST_CASE("parse_files resets the parser after a failed file") {
+		const std::vector<std::filesystem::path> fpaths = {
+			"bad.txt", "good.txt", "bad2.txt", "good2.txt" };
+		for (bool reset: { true, false }) {
+			int nallocs = 0, nfrees = 0;
+			parse_files_options options;
+			options.nthreads = 1;
+			if (reset) {
+				options.parseinit = [](void *pparser) {
+					static_cast<fake_parser *>(pparser)->mid_parse = false;
+				};
+				options.parsefinalize = [](void *) {};
+			}
+			std::vector<file_parse_result<fake_context>> results;
+			parse_files_stats stats;
+			int nfailed = parse_files<fake_context>(results, stats, fpaths,
+				[&](malloc_func_type) -> void * {
+					nallocs++;
+					return new fake_parser();
+				},
+				[&](void *pparser, free_func_type) {
+					nfrees++;
+					delete static_cast<fake_parser *>(pparser);
+				},
+				[](fake_context& ctx, void *pparser,
+					const std::filesystem::path& fpath) {
+					fake_parser& parser = *static_cast<fake_parser *>(pparser);
+					ctx.name = fpath.stem().string();
+					if (parser.mid_parse) {
+						return 2;
+					}
+					parser.mid_parse = true;
+					if (ctx.name.rfind("bad", 0) == 0) {
+						return 1;
+					}
+					parser.mid_parse = false;
+					return 0;
+				}, options);
+			CHECK_EQ(nfailed, 2);
+			REQUIRE_EQ(results.size(), 4);
+			CHECK_EQ(results[0].status, 1);
+			CHECK_EQ(results[1].status, 0);
+			CHECK_EQ(results[2].status, 1);
+			CHECK_EQ(results[3].status, 0);
+			CHECK_EQ(nallocs, reset ? 1 : 3);
+			CHECK_EQ(nfrees, nallocs);
+		}
+	}
+	
+	/**@test A parser session allocates its parser from its arena, and only
+	 *   while the session lasts is that arena current.*/
+	TEST_CASE("lemon_parser_session allocates from its arena") {
+		parse_arena arena(1024);
+		CHECK_EQ(parse_arena::current(), nullptr);
+		void *stack = nullptr;
+		{
+			lemon_parser_session session(arena,
+				[](malloc_func_type m) -> void * { return m(128); },
+				[&stack](void *pparser, free_func_type f) {
+					f(stack);
+					f(pparser);
+				});
+			REQUIRE_NE(session.get(), nullptr);
+			CHECK_EQ(parse_arena::current(), &arena);
+			CHECK_GE(arena.bytes_allocated(), 128);
+			
+			// grow a parser stack the way Lemon does, with realloc
+			stack = arena_realloc(nullptr, 16);
+			std::memcpy(stack, "0123456789abcde", 16);
+			stack = arena_realloc(stack, 4096);
+			CHECK_EQ(std::string(static_cast<char *>(stack)),
+				"0123456789abcde");
+			CHECK_GE(arena.bytes_allocated(), 128 + 16 + 4096);
+		}
+		CHECK_EQ(parse_arena::current(), nullptr);
+		arena.release();
+		CHECK_EQ(arena.bytes_allocated(), 0);
+		
+		// without a current arena, memory comes from the heap
+		void *mem = arena_malloc(64);
+		REQUIRE_NE(mem, nullptr);
+		mem = arena_realloc(mem, 256);
+		arena_free(mem);
+		CHECK_EQ(arena.bytes_allocated(), 0);
+	}
+	
+	/**@brief Stands in for the declarations that Lemon generates, for
+	 *   @ref LARGEMELON_EXPECTED_TOKEN_IDS_NEWER: a grammar with 6 terminals
+	 *   and 4 states, in which state @e s expects the token IDs divisible by
+	 *   <em>s</em> + 1.*/
+	namespace fake_lemon {
+		typedef unsigned char YYCODETYPE;
+		typedef unsigned char YYACTIONTYPE;
+		constexpr size_t YYNTOKEN = 6;
+		constexpr size_t YYNSTATE = 4;
+		constexpr YYACTIONTYPE YY_ERROR_ACTION = 255;
+		struct yyStackEntry {
+			YYACTIONTYPE stateno;
+		};
+		struct yyParser {
+			yyStackEntry *yytos;
+		};
+		/**@brief Number of calls to @ref yy_find_shift_action.*/
+		std::atomic<int> nfinds{0};
+		inline YYACTIONTYPE yy_find_shift_action(const YYCODETYPE iLookAhead,
+			const YYACTIONTYPE stateno) {
+			nfinds++;
+			return (iLookAhead % (stateno + 1) == 0) ? stateno
+				: YY_ERROR_ACTION;
+		}
+		/**@brief Next-expected token IDs, as queried from the grammar.*/
+		inline const std::bitset<YYNTOKEN>& expected(void *yypParser) {
+			return LARGEMELON_EXPECTED_TOKEN_IDS_NEWER(yypParser);
+		}
+	}
+	
+	/**@brief Stands in for a second grammar of the same size as
+	 *   @ref fake_lemon, in which state @e s expects the token IDs that are
+	 *   @e not divisible by <em>s</em> + 1.*/
+	namespace fake_lemon_other {
+		using fake_lemon::YYCODETYPE;
+		using fake_lemon::YYACTIONTYPE;
+		using fake_lemon::YYNTOKEN;
+		using fake_lemon::YYNSTATE;
+		using fake_lemon::YY_ERROR_ACTION;
+		using fake_lemon::yyStackEntry;
+		using fake_lemon::yyParser;
+		inline YYACTIONTYPE yy_find_shift_action(const YYCODETYPE iLookAhead,
+			const YYACTIONTYPE stateno) {
+			return (iLookAhead % (stateno + 1) != 0) ? stateno
+				: YY_ERROR_ACTION;
+		}
+		/**@brief Next-expected token IDs, as queried from the grammar.*/
+		inline const std::bitset<YYNTOKEN>& expected(void *yypParser) {
+			return LARGEMELON_EXPECTED_TOKEN_IDS_NEWER(yypParser);
+		}
+	}
+	
+	/**@test The expected-token set of each parser state is computed in one
+	 *   pass the first time it's asked for, from whichever thread, and then
+	 *   reused.*/
+	TEST_CASE("expected token IDs are cached per parser state") {
+		std::vector<std::thread> threads;
+		std::atomic<int> nwrong{0};
+		for (int t=0; t<4; t++) {
+			threads.emplace_back([&nwrong]() {
+				for (int pass=0; pass<3; pass++) {
+					for (unsigned char s=0; s<fake_lemon::YYNSTATE; s++) {
+						fake_lemon::yyStackEntry top = { s };
+						fake_lemon::yyParser parser = { &top };
+						const auto& ids = fake_lemon::expected(&parser);
+						for (size_t i=0; i<fake_lemon::YYNTOKEN; i++) {
+							bool want = (i > 0 && i % (s + 1) == 0);
+							nwrong += (ids[i] != want);
+						}
+					}
+				}
+			});
+		}
+		for (auto& t: threads) {
+			t.join();
+		}
+		CHECK_EQ(nwrong.load(), 0);
+		CHECK_EQ(fake_lemon::nfinds.load(),
+			static_cast<int>(fake_lemon::YYNSTATE * (fake_lemon::YYNTOKEN - 1)));
+	}
+	
+	/**@test Two grammars with the same numbers of terminals and states, and
+	 *   the same parser type name, keep separate expected-token caches.*/
+	TEST_CASE("expected token IDs are cached per grammar") {
+		for (unsigned char s=0; s<fake_lemon::YYNSTATE; s++) {
+			fake_lemon::yyStackEntry top = { s };
+			fake_lemon::yyParser parser = { &top };
+			const auto& other = fake_lemon_other::expected(&parser);
+			const auto& ids = fake_lemon::expected(&parser);
+			for (size_t i=1; i<fake_lemon::YYNTOKEN; i++) {
+				CHECK_EQ(ids[i], i % (s + 1) == 0);
+				CHECK_EQ(other[i], i % (s + 1) != 0);
+			}
+		}
+	}
+	
+	/**@test Parsing files reports how they were scheduled, and the results
+	 *   are in the order of the paths whatever the schedule.*/
+	TEST_CASE("parse_files reports scheduling statistics") {
+		std::vector<std::filesystem::path> fpaths;
+		for (int i=0; i<12; i++) {
+			fpaths.push_back(write_temp_file("largemelon_batch"
+				+ std::to_string(i) + ".txt", std::string(i * 100, 'x')));
+		}
+		parse_files_options options;
+		options.nthreads = 3;
+		options.batch_bytes = 1000;
+		options.file_overhead_bytes = 0;
+		std::atomic<int> ninits{0};
+		options.parseinit = [&ninits](void *) { ninits++; };
+		options.parsefinalize = [](void *) {};
+		std::vector<file_parse_result<fake_context>> results;
+		parse_files_stats stats;
+		int nfailed = parse_files<fake_context>(results, stats, fpaths,
+			[](malloc_func_type) -> void * { return new fake_parser(); },
+			[](void *pparser, free_func_type) {
+				delete static_cast<fake_parser *>(pparser); },
+			[](fake_context& ctx, void *, const std::filesystem::path& fpath) {
+				ctx.name = fpath.filename().string();
+				return 0;
+			}, options);
+		CHECK_EQ(nfailed, 0);
+		CHECK_EQ(stats.nfiles, 12);
+		CHECK_EQ(stats.nthreads, 3);
+		CHECK_EQ(stats.total_bytes, 6600);
+		CHECK_EQ(ninits.load(), 12);
+		CHECK_LT(stats.ntasks, 12);
+		CHECK_GE(stats.max_load_bytes, 2200);
+		CHECK_GE(stats.actual_makespan, 0.0);
+		CHECK_GE(stats.estimated_makespan, 0.0);
+		REQUIRE_EQ(results.size(), 12);
+		for (size_t i=0; i<results.size(); i++) {
+			CHECK_EQ(results[i].context.name, fpaths[i].filename().string());
+		}
+		std::ostringstream oss;
+		oss << stats;
+		CHECK_EQ(oss.str().rfind("12 files in ", 0), 0);
+		for (auto& fpath: fpaths) {
+			std::filesystem::remove(fpath);
+		}
+	}
+	
+	
+	
+	/**@brief Token matched by @ref toy_lex.*/
+	struct toy_token {
+		size_t begin;
+		size_t end;
+		bool operator==(const toy_token& other) const {
+			return begin == other.begin && end == other.end;
+		}
+	};
+	
+	/**@brief Stands in for a Ragel-generated scanner run by
+	 *   @ref speculative_lex, matching words and quoted strings (which may
+	 *   span lines) in state @c 1, and skipping <tt>(* ... *)</tt> comments
+	 *   in state @c 2.
+	 * @param data Pointer to first character of whole text.
+	 * @param rp Scanner registers.
+	 * @param tokens Matched tokens.
+	 * @return @c 0 on success, @c 1 on an unterminated string.*/
+	inline int toy_lex(const char *data, ragel_scanner_pers_type& rp,
+		std::vector<toy_token>& tokens) {
+		const char *p = rp.p;
+		for (;;) {
+			while (p < rp.pe && std::isspace(static_cast<unsigned char>(*p))) {
+				p++;
+			}
+			if (p == rp.pe) {
+				break;
+			}
+			const char *q = p;
+			if (rp.cs == 1 && *p == '"') {
+				q = static_cast<const char *>(std::memchr(p + 1, '"',
+					rp.pe - p - 1));
+				if (q == nullptr) {
+					rp.cs = 0;
+					rp.p = p;
+					return 1;
+				}
+				q++;
+			}
+			else {
+				while (q < rp.pe
+					&& ! std::isspace(static_cast<unsigned char>(*q))) {
+					q++;
+				}
+			}
+			std::string word(p, q);
+			if (rp.cs == 2) {
+				rp.cs = (word == "*)") ? 1 : 2;
+			}
+			else if (word == "(*") {
+				rp.cs = 2;
+			}
+			else {
+				tokens.push_back({ static_cast<size_t>(p - data),
+					static_cast<size_t>(q - data) });
+			}
+			p = q;
+		}
+		rp.p = p;
+		return 0;
+	}
+	
+	/**@test Scanning in parallel matches the same tokens as scanning in one
+	 *   go, with comments and strings spanning the seams between chunks, and
+	 *   the line index locates them as @ref mtext_loc does.*/
+	TEST_CASE("speculative_lex matches serial scanning") {
+		std::string text;
+		std::mt19937 rng(7);
+		for (int i=0; i<400; i++) {
+			switch (rng() % 6) {
+				case 0: text += "(* a comment\nover two lines *) "; break;
+				case 1: text += "\"a string\r\nover\ntwo lines\" "; break;
+				case 2: text += "\r\n"; break;
+				default: text += "word" + std::to_string(i) + " "; break;
+			}
+			if (rng() % 3 == 0) {
+				text += "\n";
+			}
+		}
+		chunk_lex_func_type<toy_token> lex = [&text](
+			ragel_scanner_pers_type& rp, std::vector<toy_token>& tokens) {
+			return toy_lex(text.data(), rp, tokens);
+		};
+		std::vector<toy_token> expected;
+		line_index lines;
+		REQUIRE_EQ(speculative_lex(expected, lines, text.data(), text.size(),
+			1, lex, 1), 0);
+		REQUIRE_GT(expected.size(), 100);
+		text_loc loc = FIRST_TEXT_LOC;
+		size_t prev_end = 0;
+		for (auto& t: expected) {
+			loc = mtext_loc(loc, text.data() + prev_end, text.data() + t.begin);
+			loc = mtext_loc(loc, text.data() + t.begin, text.data() + t.end);
+			CHECK_EQ(lines.loc(t.begin, t.end), loc);
+			prev_end = t.end;
+		}
+		for (size_t nthreads: { 2, 3, 8, 64 }) {
+			std::vector<toy_token> tokens;
+			line_index plines;
+			REQUIRE_EQ(speculative_lex(tokens, plines, text.data(), text.size(),
+				1, lex, nthreads, 1), 0);
+			REQUIRE_EQ(tokens.size(), expected.size());
+			for (size_t i=0; i<tokens.size(); i++) {
+				CHECK_EQ(tokens[i].begin, expected[i].begin);
+				CHECK_EQ(tokens[i].end, expected[i].end);
+			}
+			CHECK_EQ(plines.line_count(), lines.line_count());
+		}
+		
+		// an unterminated string fails wherever the text is cut
+		text += "\"no closing quote\n";
+		for (size_t nthreads: { 1, 4 }) {
+			std::vector<toy_token> tokens;
+			CHECK_NE(speculative_lex(tokens, lines, text.data(), text.size(), 1,
+				lex, nthreads, 1), 0);
+		}
+	}
+	
+	/**@test A token left unterminated in a middle chunk fails the whole scan,
+	 *   with the same tokens as scanning in one go, even though the chunks
+	 *   after it scan cleanly.*/
+	TEST_CASE("speculative_lex fails on an unterminated token mid-text") {
+		std::string text;
+		for (int i=0; i<200; i++) {
+			text += "word" + std::to_string(i) + "\n";
+			if (i == 100) {
+				text += "\"no closing quote\n";
+			}
+		}
+		chunk_lex_func_type<toy_token> lex = [&text](
+			ragel_scanner_pers_type& rp, std::vector<toy_token>& tokens) {
+			return toy_lex(text.data(), rp, tokens);
+		};
+		std::vector<toy_token> expected;
+		line_index lines;
+		CHECK_NE(speculative_lex(expected, lines, text.data(), text.size(), 1,
+			lex, 1), 0);
+		REQUIRE_EQ(expected.size(), 101);
+		for (size_t nthreads: { 2, 4, 16 }) {
+			std::vector<toy_token> tokens;
+			CHECK_NE(speculative_lex(tokens, lines, text.data(), text.size(), 1,
+				lex, nthreads, 1), 0);
+			CHECK(tokens == expected);
+		}
+	}
+	
+	
+	
+	/**@brief AST root node for @ref parse_regions tests, owning a list of
+	 *   data declarations.*/
+	class ast_test_root : public ast_typed_base<nt::ROOT> {
+		/**@brief Data declarations.*/
+		std::vector< std::unique_ptr<ast_base> > decls_;
+	public:
+		ast_test_root() : ast_typed_base<nt::ROOT>(EMPTY_TEXT_LOC) {}
+		/**@brief Appends a declaration, taking ownership of it.*/
+		void append(ast_base* const decl) {
+			decls_.emplace_back(decl);
+			add_child(decl);
+		}
+		/**@brief Takes over the declarations of another root node.*/
+		void graft(ast_test_root& other) {
+			std::move(other.decls_.begin(), other.decls_.end(),
+				std::back_inserter(decls_));
+			other.decls_.clear();
+			graft_childs(other);
+		}
+		/**@brief Replaces a run of declarations with those of another root
+		 *   node, deleting them.*/
+		void replace(const size_t pos, const size_t count,
+			ast_test_root& other) {
+			std::vector<ast_base*> old(childs().begin() + pos,
+				childs().begin() + pos + count);
+			splice_childs(pos, count, other);
+			for (ast_base* const decl: old) {
+				decls_.erase(std::find_if(decls_.begin(), decls_.end(),
+					[decl](const std::unique_ptr<ast_base>& d) {
+						return d.get() == decl; }));
+			}
+			std::move(other.decls_.begin(), other.decls_.end(),
+				std::back_inserter(decls_));
+			other.decls_.clear();
+		}
+	};
+	
+	/**@brief Parsing context for @ref parse_regions tests.*/
+	struct region_context {
+		std::unique_ptr<ast_test_root> root;
+	};
+	
+	/**@brief Stands in for a Ragel scanner and Lemon parser run by
+	 *   @ref parse_regions, parsing declarations like <tt>name = true</tt>
+	 *   continued by lines like <tt>|| false</tt>, indented or not.
+	 * @return @c 0 on success, @c 1 if a region starts with a continuation
+	 *   line.*/
+	inline int toy_parse_region(region_context& ctx, const char *ts,
+		const char *te, const text_loc& prev_loc) {
+		ctx.root = std::make_unique<ast_test_root>();
+		text_loc loc = prev_loc;
+		std::string name;
+		text_loc name_loc = prev_loc;
+		ast_base *expr = nullptr;
+		auto flush = [&]() {
+			if (expr != nullptr) {
+				ctx.root->append(new ast_data_decl(
+					span_loc(name_loc, expr->loc()), name, expr));
+				expr = nullptr;
+			}
+		};
+		std::vector<std::pair<std::string, text_loc>> words;
+		auto end_line = [&]() {
+			if (! words.empty() && words[0].first == "||") {
+				if (expr == nullptr) {
+					return 1;
+				}
+				auto rexpr = new ast_bool_literal(words[1].second,
+					words[1].first == "true");
+				expr = new ast_binop_logor(span_loc(expr->loc(), rexpr->loc()),
+					expr, rexpr);
+			}
+			else if (! words.empty()) {
+				flush();
+				name = words[0].first;
+				name_loc = words[0].second;
+				expr = new ast_bool_literal(words[2].second,
+					words[2].first == "true");
+			}
+			words.clear();
+			return 0;
+		};
+		for (const char *p=ts; p<te; ) {
+			const char *q = p;
+			while (q < te && *q != ' ' && *q != '\n') {
+				q++;
+			}
+			if (q == p) {
+				loc = mtext_loc(loc, p, p + 1);
+				if (*p == '\n' && end_line() != 0) {
+					return 1;
+				}
+				p++;
+				continue;
+			}
+			loc = mtext_loc(loc, p, q);
+			words.emplace_back(std::string(p, q), loc);
+			p = q;
+		}
+		if (end_line() != 0) {
+			return 1;
+		}
+		flush();
+		return 0;
+	}
+	
+	/**@test Parsing regions in parallel grafts the same declarations, at the
+	 *   same locations, under one root as parsing in one go, and falls back to
+	 *   parsing in one go when a region can't be parsed on its own.*/
+	TEST_CASE("parse_regions matches serial parsing") {
+		for (bool indented: { true, false }) {
+			std::string text;
+			for (int i=0; i<300; i++) {
+				text += "decl" + std::to_string(i) + " = true\n";
+				for (int j=0; j<i%3; j++) {
+					text += indented ? "  || false\n" : "|| false\n";
+				}
+			}
+			std::atomic<int> nwhole{0};
+			auto parse = [&](const size_t nthreads, region_context& ctx) {
+				return parse_regions<region_context>(ctx, text.data(),
+					text.size(),
+					[](malloc_func_type) -> void * { return new fake_parser(); },
+					[](void *pparser, free_func_type) {
+						delete static_cast<fake_parser *>(pparser); },
+					[&](region_context& c, void *, const char *ts,
+						const char *te, const text_loc& prev_loc) {
+						if (ts == text.data() && te == text.data() + text.size()) {
+							nwhole++;
+						}
+						return toy_parse_region(c, ts, te, prev_loc);
+					},
+					[](region_context& whole, region_context& part) {
+						if (! whole.root) {
+							whole.root = std::move(part.root);
+						}
+						else {
+							whole.root->graft(*part.root);
+						}
+					}, nthreads, 1);
+			};
+			region_context expected;
+			REQUIRE_EQ(parse(1, expected), 0);
+			CHECK_EQ(nwhole.load(), 1);
+			region_context actual;
+			nwhole = 0;
+			REQUIRE_EQ(parse(8, actual), 0);
+			CHECK_EQ(nwhole.load(), indented ? 0 : 1);
+			REQUIRE_EQ(actual.root->childs().size(), 300);
+			for (size_t i=0; i<300; i++) {
+				auto e = static_cast<ast_data_decl *>(expected.root->childs()[i]);
+				auto a = static_cast<ast_data_decl *>(actual.root->childs()[i]);
+				CHECK_EQ(a->name(), e->name());
+				CHECK_EQ(a->loc(), e->loc());
+				CHECK_EQ(a->expr()->loc(), e->expr()->loc());
+				CHECK_EQ(a->parent(), actual.root.get());
+			}
+		}
+	}
+	
+	/**@test Scanning again around each of a series of random edits matches
+	 *   the same tokens, with the same locations, as scanning the edited text
+	 *   in one go, while scanning much less text.*/
+	TEST_CASE("incremental_lexer matches scanning the edited text") {
+		std::string text;
+		std::mt19937 rng(11);
+		for (int i=0; i<300; i++) {
+			switch (rng() % 6) {
+				case 0: text += "(* a comment\nover two lines *) "; break;
+				case 1: text += "\"a string\r\nover\ntwo lines\" "; break;
+				case 2: text += "\r\n"; break;
+				default: text += "word" + std::to_string(i) + " "; break;
+			}
+			if (rng() % 3 == 0) {
+				text += "\n";
+			}
+		}
+		chunk_lex_func_type<toy_token> lex = [&text](
+			ragel_scanner_pers_type& rp, std::vector<toy_token>& tokens) {
+			return toy_lex(text.data(), rp, tokens);
+		};
+		incremental_lexer<toy_token> lexer(1, lex, nullptr, 64);
+		REQUIRE_EQ(lexer.lex(text.data(), text.size()), 0);
+		const char *inserts[] = { "", "x", " word ", "\n", "(* ", " *) ",
+			"\"", "\r\n" };
+		size_t nscanned = 0;
+		for (int e=0; e<60; e++) {
+			text_edit edit;
+			edit.offset = rng() % (text.size() + 1);
+			edit.old_size = std::min<size_t>(rng() % 8, text.size()
+				- edit.offset);
+			std::string s = inserts[rng() % 8];
+			edit.new_size = s.size();
+			text.replace(edit.offset, edit.old_size, s);
+			int rc = lexer.relex(text.data(), text.size(), edit);
+			const relex_span& span = lexer.last_relex();
+			nscanned += span.end - span.begin;
+			CHECK_LE(span.begin, edit.offset);
+			CHECK_GE(span.end, edit.offset + edit.new_size);
+			
+			std::vector<toy_token> expected;
+			line_index lines;
+			REQUIRE_EQ(rc, speculative_lex(expected, lines, text.data(),
+				text.size(), 1, lex, 1));
+			if (rc != 0) {
+				continue;
+			}
+			const std::vector<toy_token>& tokens = lexer.tokens();
+			REQUIRE_EQ(tokens.size(), expected.size());
+			for (size_t i=0; i<tokens.size(); i++) {
+				CHECK_EQ(tokens[i].begin, expected[i].begin);
+				CHECK_EQ(tokens[i].end, expected[i].end);
+				CHECK_EQ(lexer.lines().loc(tokens[i].begin, tokens[i].end),
+					lines.loc(expected[i].begin, expected[i].end));
+			}
+			CHECK_EQ(lexer.lines().line_count(), lines.line_count());
+			CHECK_LE(span.first_token + span.ninserted, tokens.size());
+		}
+		CHECK_LT(nscanned, 60 * text.size() / 4);
+	}
+	
+	/**@test After an edit inside a declaration, shifting the AST and parsing
+	 *   again only the declaration enclosing the changed tokens gives the same
+	 *   declarations, at the same locations, as parsing the edited text in one
+	 *   go.*/
+	TEST_CASE("smallest_enclosing_node reparses only the edited declaration") {
+		std::string text;
+		for (int i=0; i<40; i++) {
+			text += "decl" + std::to_string(i) + " = true\n";
+			for (int j=0; j<i%3; j++) {
+				text += "  || false\n";
+			}
+		}
+		chunk_lex_func_type<toy_token> lex = [&text](
+			ragel_scanner_pers_type& rp, std::vector<toy_token>& tokens) {
+			return toy_lex(text.data(), rp, tokens);
+		};
+		incremental_lexer<toy_token> lexer(1, lex, nullptr, 32);
+		REQUIRE_EQ(lexer.lex(text.data(), text.size()), 0);
+		region_context ctx;
+		REQUIRE_EQ(toy_parse_region(ctx, text.data(), text.data() + text.size(),
+			FIRST_TEXT_LOC), 0);
+		
+		struct { std::string find; size_t skip, old_size; std::string s; }
+			edits[] = {
+			{ "decl20 = true", 9, 4, "false\n  || true" },
+			{ "decl29 = true\n  || false", 13, 11, "" },
+			{ "decl4 = true", 0, 5, "renamed" },
+		};
+		for (auto& ed: edits) {
+			text_edit edit = { text.find(ed.find) + ed.skip, ed.old_size,
+				ed.s.size() };
+			text.replace(edit.offset, edit.old_size, ed.s);
+			REQUIRE_EQ(lexer.relex(text.data(), text.size(), edit), 0);
+			const relex_span& span = lexer.last_relex();
+			const line_index& lines = lexer.lines();
+			const std::vector<toy_token>& tokens = lexer.tokens();
+			text_loc loc = lines.loc(edit.offset, edit.offset + edit.new_size);
+			if (span.ninserted > 0) {
+				loc = span_loc(loc, span_loc(
+					lines.loc(tokens[span.first_token].begin,
+						tokens[span.first_token].end),
+					lines.loc(tokens[span.first_token + span.ninserted - 1].begin,
+						tokens[span.first_token + span.ninserted - 1].end)));
+			}
+			
+			ctx.root->shift_locs(span.delta);
+			ast_base *node = smallest_enclosing_node<nt>(ctx.root.get(), loc,
+				[](const ast_base& n) { return n.type() == nt::DATA_DECL; });
+			REQUIRE_NE(node, ctx.root.get());
+			size_t pos = std::find(ctx.root->childs().begin(),
+				ctx.root->childs().end(), node) - ctx.root->childs().begin();
+			size_t lno = node->loc().first_lno;
+			size_t begin = lines.offset(lno, 0);
+			size_t end = (node->loc().last_lno < lines.line_count())
+				? lines.offset(node->loc().last_lno + 1, 0) : text.size();
+			region_context part;
+			REQUIRE_EQ(toy_parse_region(part, text.data() + begin,
+				text.data() + end, text_loc{ lno, 0, lno, 0 }), 0);
+			ctx.root->replace(pos, 1, *part.root);
+			
+			region_context expected;
+			REQUIRE_EQ(toy_parse_region(expected, text.data(),
+				text.data() + text.size(), FIRST_TEXT_LOC), 0);
+			REQUIRE_EQ(ctx.root->childs().size(),
+				expected.root->childs().size());
+			for (size_t i=0; i<ctx.root->childs().size(); i++) {
+				auto e = static_cast<ast_data_decl *>(expected.root->childs()[i]);
+				auto a = static_cast<ast_data_decl *>(ctx.root->childs()[i]);
+				CHECK_EQ(a->name(), e->name());
+				CHECK_EQ(a->loc(), e->loc());
+				CHECK_EQ(a->expr()->loc(), e->expr()->loc());
+				CHECK_EQ(a->parent(), ctx.root.get());
+			}
+		}
+	}
+	
+	
+	
 } // namespace largemelon::test